@@ -0,0 +1,195 @@
+"""
+Host-side Merkle proof cache for the ledger_bitcoin client.
+
+While signing, the device asks the host for Merkle proofs (GET_MERKLE_LEAF_PROOF), leaf indexes
+(GET_MERKLE_LEAF_INDEX) and preimages of the merkleized PSBT maps. The stock client rebuilds the
+proof on every request and looks leaf indexes up linearly. With the cache, every list committed
+by sign_psbt (the keys and values of each map, and the lists of map commitments) is hashed once,
+and the responses for all of its leaves are serialized up front in flat arrays: the keys queried
+by the CoreDAO hooks (witness UTXO, witness script, output amount and script) are then answered
+without any hashing.
+
+Usage:
+    import proof_cache
+    proof_cache.install(cache=True)
+    with proof_cache.measure_host_time() as host:
+        client.sign_psbt(psbt, wallet, None)
+    print(host.seconds)
+"""
+
+import threading
+import time
+from contextlib import contextmanager
+from hashlib import sha256
+from io import BytesIO
+
+import ledger_bitcoin.client
+from ledger_bitcoin.client_command import ClientCommandCode, ClientCommandInterpreter
+
+# Proof elements fitting in the first response, after the leaf hash and the two length bytes
+MAX_RESPONSE_LEN = 255
+PROOF_ELEMENTS_FIRST_RESPONSE = (MAX_RESPONSE_LEN - 32 - 1 - 1) // 32
+
+_local = threading.local()
+
+
+class HostTime:
+    def __init__(self):
+        self.seconds = 0.0
+
+
+@contextmanager
+def measure_host_time():
+    """Measure the time spent by the host building commitments and answering the device."""
+    stats = HostTime()
+    _local.stats = stats
+    try:
+        yield stats
+    finally:
+        _local.stats = None
+
+
+def _account(start: float) -> None:
+    stats = getattr(_local, "stats", None)
+    if stats is not None:
+        stats.seconds += time.perf_counter() - start
+
+
+def _write_varint(n: int) -> bytes:
+    if n < 0xFD:
+        return n.to_bytes(1, "little")
+    if n <= 0xFFFF:
+        return b"\xfd" + n.to_bytes(2, "little")
+    if n <= 0xFFFFFFFF:
+        return b"\xfe" + n.to_bytes(4, "little")
+    return b"\xff" + n.to_bytes(8, "little")
+
+
+def _read_varint(stream: BytesIO) -> int:
+    prefix = stream.read(1)[0]
+    if prefix < 0xFD:
+        return prefix
+    size = {0xFD: 2, 0xFE: 4, 0xFF: 8}[prefix]
+    return int.from_bytes(stream.read(size), "little")
+
+
+def _largest_power_of_two_less_than(n: int) -> int:
+    p = 1
+    while 2 * p < n:
+        p *= 2
+    return p
+
+
+class MerkleProofCache:
+    """All the leaf hashes, leaf indexes and proofs of a Merkle tree, computed in one pass."""
+
+    def __init__(self, elements):
+        self.leaves = [sha256(b"\x00" + el).digest() for el in elements]
+        self.index = {leaf: i for i, leaf in enumerate(self.leaves)}
+        self.proofs = [[] for _ in self.leaves]
+        self.root = self._build(0, len(self.leaves)) if self.leaves else None
+        # Pre-serialized responses: first APDU and the elements left for GET_MORE_ELEMENTS
+        self.responses = [self._serialize(i) for i in range(len(self.leaves))]
+
+    def _build(self, lo: int, hi: int) -> bytes:
+        # Children are built first, so that each proof lists the siblings from the leaf to the root
+        if hi - lo == 1:
+            return self.leaves[lo]
+        split = lo + _largest_power_of_two_less_than(hi - lo)
+        left = self._build(lo, split)
+        right = self._build(split, hi)
+        for i in range(lo, split):
+            self.proofs[i].append(right)
+        for i in range(split, hi):
+            self.proofs[i].append(left)
+        return sha256(b"\x01" + left + right).digest()
+
+    def _serialize(self, i: int):
+        proof = self.proofs[i]
+        n = min(PROOF_ELEMENTS_FIRST_RESPONSE, len(proof))
+        first = self.leaves[i] + bytes([len(proof), n]) + b"".join(proof[:n])
+        return first, proof[n:]
+
+
+class TimedClientCommandInterpreter(ClientCommandInterpreter):
+    """Stock interpreter, accounting for the host time."""
+
+    def add_known_list(self, elements) -> None:
+        start = time.perf_counter()
+        super().add_known_list(elements)
+        _account(start)
+
+    def execute(self, hw_response: bytes) -> bytes:
+        start = time.perf_counter()
+        try:
+            return super().execute(hw_response)
+        finally:
+            _account(start)
+
+
+class CachedClientCommandInterpreter(TimedClientCommandInterpreter):
+    """Interpreter answering the Merkle requests from precomputed proof caches."""
+
+    def __init__(self):
+        super().__init__()
+        self.proof_caches = {}
+        self.pending_elements = []
+
+    def add_known_list(self, elements) -> None:
+        start = time.perf_counter()
+        elements = list(elements)
+        ClientCommandInterpreter.add_known_list(self, elements)
+        cache = MerkleProofCache(elements)
+        # Only use the cache if it commits to the same tree, with the same proofs, as the library
+        tree = self.known_trees.get(cache.root)
+        if tree is not None and list(tree.prove_leaf(0)) == cache.proofs[0]:
+            self.proof_caches[cache.root] = cache
+        _account(start)
+
+    def execute(self, hw_response: bytes) -> bytes:
+        start = time.perf_counter()
+        try:
+            response = self._execute_cached(hw_response)
+            if response is None:
+                response = ClientCommandInterpreter.execute(self, hw_response)
+            return response
+        finally:
+            _account(start)
+
+    def _execute_cached(self, hw_response: bytes):
+        code = hw_response[0]
+        if code == ClientCommandCode.GET_MERKLE_LEAF_PROOF:
+            req = BytesIO(hw_response[1:])
+            root = req.read(32)
+            tree_size = _read_varint(req)
+            leaf_index = _read_varint(req)
+            cache = self.proof_caches.get(root)
+            if cache is None or tree_size != len(cache.leaves) or leaf_index >= tree_size:
+                return None
+            first, leftover = cache.responses[leaf_index]
+            self.pending_elements = list(leftover)
+            return first
+
+        if code == ClientCommandCode.GET_MERKLE_LEAF_INDEX:
+            root, leaf_hash = hw_response[1:33], hw_response[33:65]
+            cache = self.proof_caches.get(root)
+            if cache is None:
+                return None
+            if leaf_hash in cache.index:
+                return b"\x01" + _write_varint(cache.index[leaf_hash])
+            return b"\x00" + _write_varint(0)
+
+        if code == ClientCommandCode.GET_MORE_ELEMENTS and self.pending_elements:
+            # Proof elements are all 32 bytes long
+            n = min(len(self.pending_elements), (MAX_RESPONSE_LEN - 2) // 32)
+            elements, self.pending_elements = self.pending_elements[:n], self.pending_elements[n:]
+            return bytes([n, 32]) + b"".join(elements)
+
+        return None
+
+
+def install(cache: bool = True) -> None:
+    """Make ledger_bitcoin's client use the cached (or only timed) interpreter."""
+    ledger_bitcoin.client.ClientCommandInterpreter = (
+        CachedClientCommandInterpreter if cache else TimedClientCommandInterpreter
+    )
@@ -0,0 +1,71 @@
+#!/usr/bin/env bash
+#
+# Report the static RAM and stack usage of the app for each device of ledger_app.toml.
+#
+# Usage: scripts/ram_report.sh [<git-rev>...]
+#
+# Each revision (default: the working tree) is built for every device, and the report lists the
+# .data + .bss size, the stack size and the RAM used by the CoreDAO globals. Give two revisions
+# to get a before/after comparison. Must run in the Ledger app builder image, where the SDKs are
+# available through $<DEVICE>_SDK. The stack high-water mark of each hook is printed at runtime by
+# a build made with `make CORE_STACK_PROFILING=1`.
+
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+DEVICES=$(sed -n 's/^devices *= *\[\(.*\)\]/\1/p' "$ROOT/ledger_app.toml" | tr -d '"' | tr ',' ' ')
+CORE_SYMBOLS="core_tx_info review last_error armed_target target_armed digest_context current_digest approved core_pubkey_cache"
+
+section_size() {
+    arm-none-eabi-size -A "$1" | awk -v s="$2" '$1 == s { print $2 }'
+}
+
+symbol_size() {
+    local size
+    size=$(arm-none-eabi-nm -S "$1" | awk -v s="$2" '$4 == s { print $2 }')
+    echo $(( 16#${size:-0} ))
+}
+
+symbol_address() {
+    local address
+    address=$(arm-none-eabi-nm "$1" | awk -v s="$2" '$3 == s { print $1 }')
+    echo $(( 16#${address:-0} ))
+}
+
+report() {
+    local tree="$1" label="$2"
+    for device in $DEVICES; do
+        local sdk_var
+        sdk_var="$(echo "$device" | tr '[:lower:]' '[:upper:]')_SDK"
+        make -C "$tree" clean > /dev/null
+        make -C "$tree" -j"$(nproc)" BOLOS_SDK="${!sdk_var}" > /dev/null
+
+        local elf="$tree/build/$device/bin/app.elf"
+        [ -f "$elf" ] || elf="$tree/bin/app.elf"
+
+        local data bss stack core=0
+        data=$(section_size "$elf" .data)
+        bss=$(section_size "$elf" .bss)
+        stack=$(( $(symbol_address "$elf" _estack) - $(symbol_address "$elf" _stack) ))
+        for symbol in $CORE_SYMBOLS; do
+            core=$(( core + $(symbol_size "$elf" "$symbol") ))
+        done
+        printf "%-12s %-8s %10d %10d %10d\n" "$label" "$device" "$(( ${data:-0} + ${bss:-0} ))" "$stack" "$core"
+    done
+}
+
+printf "%-12s %-8s %10s %10s %10s\n" "revision" "device" "data+bss" "stack" "coredao"
+
+if [ $# -eq 0 ]; then
+    report "$ROOT" "worktree"
+    exit 0
+fi
+
+for rev in "$@"; do
+    tree="$(mktemp -d)"
+    git -C "$ROOT" worktree add --detach "$tree" "$rev" > /dev/null 2>&1
+    rmdir "$tree/bitcoin_app_base" 2> /dev/null || true
+    ln -s "$ROOT/bitcoin_app_base" "$tree/bitcoin_app_base"
+    report "$tree" "$(git -C "$ROOT" rev-parse --short "$rev")"
+    git -C "$ROOT" worktree remove --force "$tree"
+done
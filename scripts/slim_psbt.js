@@ -0,0 +1,246 @@
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads');
+const { PsbtV2 } = require('ledger-bitcoin');
+const { fromBase64 } = require('uint8array-tools');
+const { toBase64 } = require('./utils.js');
+
+// Keys read by the base app and the CoreDAO app, by key type (first byte of the key, in hex).
+// Everything else (partial signatures, final scripts, hash preimages, global xpubs, proprietary
+// and unknown keys) is never queried by the device and only makes the Merkle proofs longer.
+const GLOBAL_KEYS = new Set([
+  '02', // tx version
+  '03', // fallback locktime
+  '04', // input count
+  '05', // output count
+  '06', // tx modifiable
+  'fb', // PSBT version
+]);
+
+const INPUT_KEYS = new Set([
+  '00', // non-witness UTXO
+  '01', // witness UTXO
+  '03', // sighash type
+  '04', // redeem script
+  '05', // witness script
+  '06', // bip32 derivation
+  '0e', // previous txid
+  '0f', // output index
+  '10', // sequence
+  '11', // required time locktime
+  '12', // required height locktime
+  '15', // tap leaf script
+  '16', // tap bip32 derivation
+  '17', // tap internal key
+  '18', // tap merkle root
+]);
+
+const OUTPUT_KEYS = new Set([
+  '00', // redeem script
+  '01', // witness script
+  '02', // bip32 derivation
+  '03', // amount
+  '04', // script
+  '05', // tap internal key
+  '06', // tap tree
+  '07', // tap bip32 derivation
+]);
+
+const INPUT_BIP32_DERIVATION = '06';
+const INPUT_TAP_BIP32_DERIVATION = '16';
+const OUTPUT_BIP32_DERIVATION = '02';
+const OUTPUT_TAP_BIP32_DERIVATION = '07';
+
+// Size of a Merkle proof element and number of elements per APDU exchange
+const HASH_LEN = 32;
+const PROOF_ELEMENTS_FIRST_APDU = 6;
+const PROOF_ELEMENTS_NEXT_APDU = 7;
+
+function derivationFingerprint(value, tap) {
+  let offset = 0;
+  if (tap) {
+    // <compact size number of leaf hashes> <leaf hashes> <fingerprint> <path>
+    const nLeafHashes = value[0];
+    if (nLeafHashes >= 0xfd) {
+      return null;
+    }
+    offset = 1 + nLeafHashes * HASH_LEN;
+  }
+  return Buffer.from(value.subarray(offset, offset + 4)).toString('hex');
+}
+
+function slimMap(map, allowedKeys, derivationKeys, fingerprint) {
+  for (const key of Array.from(map.keys())) {
+    const keyType = key.slice(0, 2);
+    if (!allowedKeys.has(keyType)) {
+      map.delete(key);
+      continue;
+    }
+    // Only keep the derivations of the signing device
+    const tap = derivationKeys.tap === keyType;
+    if (fingerprint && (derivationKeys.ecdsa === keyType || tap)) {
+      if (derivationFingerprint(map.get(key), tap) !== fingerprint) {
+        map.delete(key);
+      }
+    }
+  }
+}
+
+function serializedMapSize(map) {
+  let size = 1; // separator
+  for (const [key, value] of map) {
+    const keyLen = key.length / 2;
+    size += compactSizeLen(keyLen) + keyLen + compactSizeLen(value.length) + value.length;
+  }
+  return size;
+}
+
+function compactSizeLen(n) {
+  return n < 0xfd ? 1 : n <= 0xffff ? 3 : n <= 0xffffffff ? 5 : 9;
+}
+
+// Estimated cost of querying `lookups` values from a merkleized map of `n` keys: each lookup
+// proves the key and the value, and the proof elements are streamed 6 then 7 per APDU.
+function lookupCost(n, lookups) {
+  const depth = n > 1 ? Math.ceil(Math.log2(n)) : 0;
+  const apdusPerProof = 1 + Math.max(0, Math.ceil((depth - PROOF_ELEMENTS_FIRST_APDU) / PROOF_ELEMENTS_NEXT_APDU));
+  return {
+    proofBytes: lookups * 2 * depth * HASH_LEN,
+    apdus: lookups * (1 + 2 * apdusPerProof), // leaf index + key proof + value proof
+  };
+}
+
+function mapsCost(psbt, lookupsPerMap) {
+  const maps = [psbt.globalMap, ...psbt.inputMaps, ...psbt.outputMaps];
+  const cost = { bytes: 0, proofBytes: 0, apdus: 0 };
+  maps.forEach((map, i) => {
+    const lookup = lookupCost(map.size, lookupsPerMap[i]);
+    cost.bytes += serializedMapSize(map);
+    cost.proofBytes += lookup.proofBytes;
+    cost.apdus += lookup.apdus;
+  });
+  return cost;
+}
+
+/**
+ * Remove from a PSBTv2 every key that neither the base app nor the CoreDAO app reads.
+ * @param {PsbtV2} psbt The PSBT, modified in place
+ * @param {object} options `fingerprint`: hex master fingerprint of the signer; when set, the
+ *                 BIP32 derivations of other keys are removed too
+ * @returns {object} The estimated size, proof bytes and APDU count before and after
+ */
+function slimPSBT(psbt, options = {}) {
+  const fingerprint = options.fingerprint ? options.fingerprint.toLowerCase() : null;
+  const maps = [psbt.globalMap, ...psbt.inputMaps, ...psbt.outputMaps];
+
+  // The device queries the kept keys only: measure both versions with the same lookups
+  const before = { maps: maps.map((map) => new Map(map)) };
+
+  slimMap(psbt.globalMap, GLOBAL_KEYS, {}, fingerprint);
+  psbt.inputMaps.forEach((map) => slimMap(map, INPUT_KEYS,
+    { ecdsa: INPUT_BIP32_DERIVATION, tap: INPUT_TAP_BIP32_DERIVATION }, fingerprint));
+  psbt.outputMaps.forEach((map) => slimMap(map, OUTPUT_KEYS,
+    { ecdsa: OUTPUT_BIP32_DERIVATION, tap: OUTPUT_TAP_BIP32_DERIVATION }, fingerprint));
+
+  const lookups = maps.map((map) => map.size);
+  const beforePsbt = {
+    globalMap: before.maps[0],
+    inputMaps: before.maps.slice(1, 1 + psbt.inputMaps.length),
+    outputMaps: before.maps.slice(1 + psbt.inputMaps.length),
+  };
+  return {
+    before: mapsCost(beforePsbt, lookups),
+    after: mapsCost(psbt, lookups),
+  };
+}
+
+function slimBase64(encoded, options) {
+  const psbt = new PsbtV2();
+  psbt.deserialize(Buffer.copyBytesFrom(fromBase64(encoded.trim())));
+  const report = slimPSBT(psbt, options);
+  return { psbt: toBase64(psbt.serialize()), report };
+}
+
+function formatReport(name, report) {
+  const { before, after } = report;
+  return `${name}: ${before.bytes} -> ${after.bytes} bytes, ` +
+         `proofs ${before.proofBytes} -> ${after.proofBytes} bytes, ` +
+         `~${before.apdus} -> ~${after.apdus} APDUs`;
+}
+
+function processFile(file, outDir, options) {
+  const { psbt, report } = slimBase64(fs.readFileSync(file, 'utf8'), options);
+  const outFile = path.join(outDir, path.basename(file));
+  fs.writeFileSync(outFile, psbt + '\n');
+  return report;
+}
+
+async function processDirectory(dir, outDir, options) {
+  const files = fs.readdirSync(dir).filter((f) => f.endsWith('.psbt')).map((f) => path.join(dir, f));
+  const nWorkers = Math.min(files.length, os.availableParallelism ? os.availableParallelism() : os.cpus().length);
+  const total = { before: { bytes: 0, proofBytes: 0, apdus: 0 }, after: { bytes: 0, proofBytes: 0, apdus: 0 } };
+
+  fs.mkdirSync(outDir, { recursive: true });
+  const chunks = Array.from({ length: nWorkers }, (_, w) => files.filter((_, i) => i % nWorkers === w));
+  await Promise.all(chunks.map((chunk) => new Promise((resolve, reject) => {
+    const worker = new Worker(__filename, { workerData: { files: chunk, outDir, options } });
+    worker.on('message', ({ file, report }) => {
+      console.log(formatReport(path.basename(file), report));
+      for (const side of ['before', 'after']) {
+        for (const field of Object.keys(total[side])) {
+          total[side][field] += report[side][field];
+        }
+      }
+    });
+    worker.on('error', reject);
+    worker.on('exit', resolve);
+  })));
+  console.log(formatReport(`Total (${files.length} PSBTs)`, total));
+}
+
+if (!isMainThread) {
+  for (const file of workerData.files) {
+    const report = processFile(file, workerData.outDir, workerData.options);
+    parentPort.postMessage({ file, report });
+  }
+} else if (require.main === module) {
+  const args = process.argv.slice(2);
+  const options = {};
+  let outDir = null;
+  while (args.length > 1 && args[0].startsWith('--')) {
+    const flag = args.shift();
+    if (flag === '--fingerprint') {
+      options.fingerprint = args.shift();
+    } else if (flag === '--out') {
+      outDir = args.shift();
+    } else {
+      args.unshift(flag);
+      break;
+    }
+  }
+  if (args.length !== 1) {
+    console.error('Usage: node slim_psbt.js [--fingerprint <hex>] [--out <dir>] <base64 | dir>');
+    process.exit(1);
+  }
+  try {
+    if (fs.existsSync(args[0]) && fs.statSync(args[0]).isDirectory()) {
+      processDirectory(args[0], outDir || path.join(args[0], 'slim'), options).catch((error) => {
+        console.error('Error:', error);
+        process.exit(1);
+      });
+    } else {
+      const { psbt, report } = slimBase64(args[0], options);
+      console.error(formatReport('PSBT', report));
+      console.log(psbt);
+    }
+  } catch (error) {
+    console.error('Error:', error);
+    process.exit(1);
+  }
+}
+
+module.exports = {
+  slimPSBT,
+  slimBase64,
+};
@@ -0,0 +1,220 @@
+"""
+Sign a queue of CoreDAO PSBTs on several devices (or speculos instances) concurrently.
+
+Each device is driven by its own asyncio worker; the blocking APDU exchange runs on a
+dedicated thread per transport so that requests to one device never interleave. The
+partial signatures returned by the device are merged back into the PSBT, and the run
+ends with a throughput and per-device latency report.
+
+Usage:
+    python sign_fleet.py --device tcp:127.0.0.1:9999 --device tcp:127.0.0.1:9998 psbts.txt
+    python sign_fleet.py --device hid:/dev/hidraw0 --device hid:/dev/hidraw1 --out signed/ psbt_dir/
+
+The PSBT source is either a file with one base64 PSBT per line, or a directory whose
+*.psbt files each contain one base64 PSBT.
+
+The report includes the share of each round-trip spent on the host answering the device; run
+with and without --proof-cache to compare the stock client with the precomputed proof cache.
+"""
+
+import argparse
+import asyncio
+import math
+import os
+import sys
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+from ledger_bitcoin import Chain, TransportClient, WalletPolicy
+from ledger_bitcoin.client import NewClient as AppClient
+from ledger_bitcoin.psbt import PSBT
+
+import proof_cache
+
+
+EXPECTED_FINGERPRINT = "f5acc2fd"
+
+WALLET = WalletPolicy(
+    "",
+    "wpkh(@0/**)",
+    [
+        "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P"
+    ],
+)
+
+
+def open_transport(spec: str) -> TransportClient:
+    """Open a transport from a 'tcp:<host>:<port>' or 'hid:<path>' specification."""
+    interface, _, target = spec.partition(":")
+    if interface == "tcp":
+        server, _, port = target.rpartition(":")
+        return TransportClient("tcp", server=server or "127.0.0.1", port=int(port))
+    if interface == "hid":
+        return TransportClient("hid", path=target.encode() if target else None)
+    raise ValueError(f"Unsupported device specification '{spec}'")
+
+
+def load_psbts(source: str):
+    """Return a list of (name, base64 PSBT) from a file or a directory."""
+    if os.path.isdir(source):
+        names = sorted(n for n in os.listdir(source) if n.endswith(".psbt"))
+        psbts = []
+        for name in names:
+            with open(os.path.join(source, name)) as f:
+                psbts.append((name, f.read().strip()))
+        return psbts
+
+    with open(source) as f:
+        lines = [line.strip() for line in f if line.strip() and not line.startswith("#")]
+    return [(f"psbt_{i}", line) for i, line in enumerate(lines)]
+
+
+def merge_signatures(psbt: PSBT, sign_results) -> None:
+    """Add the partial signatures returned by sign_psbt to the PSBT inputs."""
+    for i, psig in sign_results:
+        if psig.tapleaf_hash is not None:
+            psbt.inputs[i].tap_script_sigs[(psig.pubkey, psig.tapleaf_hash)] = psig.signature
+        elif len(psig.pubkey) == 32:
+            psbt.inputs[i].tap_key_sig = psig.signature
+        else:
+            psbt.inputs[i].partial_sigs[psig.pubkey] = psig.signature
+
+
+def percentile(values, p):
+    """Nearest-rank percentile of a list of values."""
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    rank = max(1, math.ceil(p / 100 * len(ordered)))
+    return ordered[rank - 1]
+
+
+class Device:
+    def __init__(self, spec: str):
+        self.spec = spec
+        # A single thread per device: the transport is not thread-safe and the
+        # device only processes one APDU exchange at a time anyway.
+        self.executor = ThreadPoolExecutor(max_workers=1, thread_name_prefix=spec)
+        self.client = None
+        self.latencies = []
+        self.host_times = []
+        self.failures = 0
+
+    def connect(self) -> None:
+        self.client = AppClient(open_transport(self.spec), chain=Chain.TEST)
+        fpr = self.client.get_master_fingerprint().hex()
+        if fpr != EXPECTED_FINGERPRINT:
+            self.client.stop()
+            raise RuntimeError(f"{self.spec}: unexpected fingerprint {fpr}")
+
+    def sign(self, psbt: PSBT):
+        with proof_cache.measure_host_time() as host:
+            sign_results = self.client.sign_psbt(psbt, WALLET, None)
+        self.host_times.append(host.seconds)
+        return sign_results
+
+    def host_share(self) -> float:
+        total = sum(self.latencies)
+        return sum(self.host_times) / total if total > 0 else 0.0
+
+    def close(self) -> None:
+        if self.client is not None:
+            self.client.stop()
+        self.executor.shutdown()
+
+
+async def worker(device: Device, queue: asyncio.Queue, signed: dict) -> None:
+    loop = asyncio.get_running_loop()
+    while True:
+        try:
+            name, encoded = queue.get_nowait()
+        except asyncio.QueueEmpty:
+            return
+
+        try:
+            psbt = PSBT()
+            psbt.deserialize(encoded)
+        except Exception as e:
+            device.failures += 1
+            print(f"[{device.spec}] {name}: invalid PSBT: {e}", file=sys.stderr)
+            continue
+
+        start = time.perf_counter()
+        try:
+            sign_results = await loop.run_in_executor(device.executor, device.sign, psbt)
+        except Exception as e:
+            device.failures += 1
+            print(f"[{device.spec}] {name}: error signing PSBT: {e}", file=sys.stderr)
+            continue
+        device.latencies.append(time.perf_counter() - start)
+
+        merge_signatures(psbt, sign_results)
+        signed[name] = psbt.serialize()
+        print(f"[{device.spec}] {name}: {len(sign_results)} signature(s) "
+              f"in {device.latencies[-1]:.2f}s")
+
+
+async def run(devices, psbts, out_dir) -> int:
+    loop = asyncio.get_running_loop()
+    await asyncio.gather(*(loop.run_in_executor(d.executor, d.connect) for d in devices))
+
+    queue = asyncio.Queue()
+    for item in psbts:
+        queue.put_nowait(item)
+
+    signed = {}
+    start = time.perf_counter()
+    await asyncio.gather(*(worker(d, queue, signed) for d in devices))
+    elapsed = time.perf_counter() - start
+
+    for name, _ in psbts:
+        if name not in signed:
+            continue
+        if out_dir:
+            with open(os.path.join(out_dir, name if name.endswith(".psbt") else f"{name}.psbt"), "w") as f:
+                f.write(signed[name] + "\n")
+        else:
+            print(f"{name}: {signed[name]}")
+
+    print()
+    print(f"Signed {len(signed)}/{len(psbts)} PSBTs on {len(devices)} device(s) in {elapsed:.2f}s")
+    if elapsed > 0:
+        print(f"Throughput: {len(signed) * 60 / elapsed:.1f} PSBTs/min")
+    print(f"{'device':<28}{'signed':>8}{'failed':>8}{'p50 (s)':>10}{'p90 (s)':>10}{'p99 (s)':>10}"
+          f"{'host':>8}")
+    for d in devices:
+        print(f"{d.spec:<28}{len(d.latencies):>8}{d.failures:>8}"
+              f"{percentile(d.latencies, 50):>10.2f}"
+              f"{percentile(d.latencies, 90):>10.2f}"
+              f"{percentile(d.latencies, 99):>10.2f}"
+              f"{d.host_share():>8.1%}")
+
+    return 0 if len(signed) == len(psbts) else 1
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description="Sign CoreDAO PSBTs on several devices concurrently")
+    parser.add_argument("--device", action="append", required=True,
+                        help="tcp:<host>:<port> (speculos) or hid:<path>; repeat for each device")
+    parser.add_argument("--proof-cache", action="store_true",
+                        help="answer the device from precomputed Merkle proofs (see proof_cache.py)")
+    parser.add_argument("--out", help="directory where signed PSBTs are written (default: stdout)")
+    parser.add_argument("source", help="file with one base64 PSBT per line, or directory of *.psbt files")
+    args = parser.parse_args()
+
+    proof_cache.install(cache=args.proof_cache)
+
+    psbts = load_psbts(args.source)
+    if not psbts:
+        print("No PSBT to sign")
+        exit(1)
+    if args.out:
+        os.makedirs(args.out, exist_ok=True)
+
+    devices = [Device(spec) for spec in args.device]
+    try:
+        code = asyncio.run(run(devices, psbts, args.out))
+    finally:
+        for d in devices:
+            d.close()
+    exit(code)
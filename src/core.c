@@ -22,6 +22,45 @@
 
 static const char *SAT_PLUS = "SAT+";
 
+// Public key at CORE_DERIVATION_PATH
+static struct {
+    bool valid;
+    uint8_t pubkey[33];
+} core_pubkey_cache;
+
+static struct {
+    core_error_code_t code;
+    core_error_location_t location;
+    uint32_t index;
+} last_error;
+
+void core_error_set(core_error_code_t code, core_error_location_t location, uint32_t index) {
+    if (last_error.code != CORE_ERR_NONE) {
+        return;
+    }
+    last_error.code = code;
+    last_error.location = location;
+    last_error.index = index;
+}
+
+void core_error_set_location(core_error_location_t location, uint32_t index) {
+    if (last_error.code == CORE_ERR_NONE || last_error.location != CORE_ERR_LOC_NONE) {
+        return;
+    }
+    last_error.location = location;
+    last_error.index = index;
+}
+
+void core_error_clear(void) {
+    explicit_bzero(&last_error, sizeof(last_error));
+}
+
+void core_error_serialize(uint8_t out[static CORE_ERROR_DETAIL_LEN]) {
+    out[0] = (uint8_t) last_error.code;
+    out[1] = (uint8_t) last_error.location;
+    write_u32_be(out, 2, last_error.index);
+}
+
 bool parse_staking_information(
     uint8_t *payload,
     uint32_t payload_len,
@@ -30,12 +69,14 @@ bool parse_staking_information(
 ) {
     if (payload_len != EXPECTED_PAYLOAD_LEN) {
         PRINT("Expected payload length %d, got %d\n", EXPECTED_PAYLOAD_LEN, payload_len);
+        core_error_set(CORE_ERR_PAYLOAD_LENGTH, CORE_ERR_LOC_NONE, 0);
         return false;
     }
 
     // Read SAT+
     if (memcmp(payload, SAT_PLUS, 4) != 0) {
         PRINT("Invalid SAT+ prefix\n");
+        core_error_set(CORE_ERR_SAT_PREFIX, CORE_ERR_LOC_NONE, 0);
         return false;
     }
     payload += 4;
@@ -43,6 +84,7 @@ bool parse_staking_information(
     // Read version
     if (*payload != SUPPORTED_VERSION) {
         PRINT("Unsupported version %d\n", *payload);
+        core_error_set(CORE_ERR_VERSION, CORE_ERR_LOC_NONE, 0);
         return false;
     }
     payload++;
@@ -53,6 +95,7 @@ bool parse_staking_information(
         info->chain_id != CHAIN_ID_TESTNET &&
         info->chain_id != CHAIN_ID_TESTNET2) {
         PRINT("Unsupported chain id %d\n", info->chain_id);
+        core_error_set(CORE_ERR_CHAIN_ID, CORE_ERR_LOC_NONE, 0);
         return false;
     }
     payload += 2;
@@ -143,8 +186,19 @@ bool validate_lock_script_pubkey(
 bool get_core_compressed_pubkey(uint8_t pubkey[static 33]) {
     uint32_t path[] = CORE_DERIVATION_PATH;
     uint8_t chaincode[32];
-    
-    return crypto_get_compressed_pubkey_at_path(path, CORE_DERIVATION_PATH_LEN, pubkey, chaincode);
+
+    // The derivation is the costly part of every script validation, it is done once per session
+    if (!core_pubkey_cache.valid) {
+        if (!crypto_get_compressed_pubkey_at_path(path,
+                                                  CORE_DERIVATION_PATH_LEN,
+                                                  core_pubkey_cache.pubkey,
+                                                  chaincode)) {
+            return false;
+        }
+        core_pubkey_cache.valid = true;
+    }
+    memcpy(pubkey, core_pubkey_cache.pubkey, 33);
+    return true;
 }
 
 bool get_core_pubkey_hash160(uint8_t hash160[static 20]) {
@@ -8,6 +8,7 @@
 #define REDEEM_SCRIPT_LEN 32
 #define SCRIPT_HASH_LEN 32
 #define LOCK_SCRIPT_LEN 34
+#define SCRIPT_PUBKEY_BUFFER_LEN 83 // Max length for OP_RETURN scriptPubKey
 #define CHAID_ID_MAINNET 1116
 #define CHAIN_ID_TESTNET 1115
 #define CHAIN_ID_TESTNET2 1114
@@ -29,21 +30,49 @@ typedef enum {
     TYPE_TX_INVALID = 1 << 2,
 } tx_type_t;
 
+// Reason of the last rejection, reported by the error-detail APDU
+typedef enum {
+    CORE_ERR_NONE = 0,
+    CORE_ERR_PAYLOAD_LENGTH = 1,       // OP_RETURN payload is not 80 bytes long
+    CORE_ERR_SAT_PREFIX = 2,           // OP_RETURN payload does not start with SAT+
+    CORE_ERR_VERSION = 3,              // Unsupported payload version
+    CORE_ERR_CHAIN_ID = 4,             // Unsupported chain id
+    CORE_ERR_OP_RETURN_AMOUNT = 5,     // OP_RETURN output amount is not zero
+    CORE_ERR_REDEEM_SCRIPT = 6,        // Redeem script does not match the CoreDAO key
+    CORE_ERR_LOCK_SCRIPT = 7,          // Lock output does not commit to the redeem script
+    CORE_ERR_OUTPUT_COUNT = 8,         // Staking transaction does not have 2 or 3 outputs
+    CORE_ERR_OUTPUT_MISSING_FIELD = 9, // Output amount or script missing
+    CORE_ERR_INPUT_WITNESS_UTXO = 10,  // External input witness UTXO missing or not P2WSH
+    CORE_ERR_INPUT_WITNESS_SCRIPT = 11,// External input witness script missing or invalid length
+    CORE_ERR_MAP_UNREADABLE = 12,      // Input or output map missing or unreadable
+    CORE_ERR_UNEXPECTED_OUTPUT = 13,   // External output that is neither OP_RETURN nor a lock output
+    CORE_ERR_INPUT_OUTPOINT = 14,      // External input previous txid or output index missing
+    CORE_ERR_SIGNING = 15,             // CoreDAO input could not be signed
+} core_error_code_t;
+
+// Location of the failing check
+typedef enum {
+    CORE_ERR_LOC_NONE = 0,
+    CORE_ERR_LOC_INPUT = 1,
+    CORE_ERR_LOC_OUTPUT = 2,
+} core_error_location_t;
+
+// error code(1) + location(1) + index(4)
+#define CORE_ERROR_DETAIL_LEN 6
+
+// Fields are ordered by decreasing alignment to keep padding to the trailing byte
 typedef struct {
-    // Global informations
+    // Stake and unstake amounts
+    uint64_t lock_amount;
+    uint64_t unlock_amount;
     tx_type_t type;
-
-    // Stake informations
+    uint32_t locktime;
+    uint32_t n_core_dao_inputs;
     uint16_t chain_id;
+    uint8_t fee;
     uint8_t delegator[20];
     uint8_t validator[20];
-    uint64_t lock_amount;
-    uint8_t fee;
-    uint32_t locktime;
-
-    // Unstake informations
-    uint64_t unlock_amount;
-    uint32_t n_core_dao_inputs;
+    // Bitvector of the CoreDAO inputs
     uint8_t  core_inputs[64];
 } core_dao_tx_info_t;
 
@@ -63,6 +92,26 @@ bool parse_staking_information(
     uint8_t redeem_script[static REDEEM_SCRIPT_LEN]
 );
 
+/***
+ * Record the reason of a rejection; only the first one is kept as the others are consequences
+ * @param code The failing check
+ * @param location Whether index refers to an input or an output
+ * @param index The index of the offending input or output
+ */
+void core_error_set(core_error_code_t code, core_error_location_t location, uint32_t index);
+
+/***
+ * Set the location of the last error if it was recorded without one
+ */
+void core_error_set_location(core_error_location_t location, uint32_t index);
+
+void core_error_clear(void);
+
+/***
+ * Serialize the last error as code(1) | location(1) | index(4, big-endian)
+ */
+void core_error_serialize(uint8_t out[static CORE_ERROR_DETAIL_LEN]);
+
 bool validate_redeem_script(uint8_t redeem_script[static REDEEM_SCRIPT_LEN]);
 
 bool validate_lock_script_pubkey(
@@ -4,6 +4,7 @@
 #include "../bitcoin_app_base/src/ui/menu.h"
 #include "io.h"
 #include "core.h"
+#include "staking_target.h"
 #include "nbgl_use_case.h"
 #include "time_helper.h"
 
@@ -18,43 +19,71 @@ static void review_choice(bool approved) {
     }
 }
 
+static void registration_choice(bool approved) {
+    set_ux_flow_response(approved); // sets the return value of io_ui_process
+
+    if (approved) {
+        nbgl_useCaseStatus("Staking target\nregistered", true, ui_menu_main);
+    } else {
+        nbgl_useCaseStatus("Staking target\nrejected", false, ui_menu_main);
+    }
+}
+
 #define MAX_N_PAIRS 9
+#define AMOUNT_STR_LEN 32
+#define ADDRESS_STR_LEN (2 * 20 + 1)
+
+// Pairs and formatted values of the review. They are static rather than in the frame of the
+// display functions, which stays live during the whole UI event loop: this lowers the peak stack
+// usage at the cost of permanent RAM, which the validation buffers share.
+static union {
+    struct {
+        nbgl_layoutTagValue_t pairs[MAX_N_PAIRS];
+        nbgl_layoutTagValueList_t pair_list;
+        char value_str[AMOUNT_STR_LEN];
+        char unstake_value_str[AMOUNT_STR_LEN];
+        char fee_str[AMOUNT_STR_LEN];
+        char delegator_str[ADDRESS_STR_LEN];
+        char validator_str[ADDRESS_STR_LEN];
+        char locktime_str[DATETIME_STR_LEN];
+        char core_fee_str[4];
+    };
+    validation_buffers_t validation;
+} review;
+
+validation_buffers_t *const validation_buffers = &review.validation;
+
+static const char *chain_id_to_string(uint16_t chain_id) {
+    if (chain_id == CHAID_ID_MAINNET) {
+        return "Mainnet";
+    } else if (chain_id == CHAIN_ID_TESTNET) {
+        return "Testnet";
+    } else if (chain_id == CHAIN_ID_TESTNET2) {
+        return "Testnet2";
+    }
+    return "Unknown";
+}
 
 bool display_transaction(
     dispatcher_context_t *dc,
     int64_t value_spent, 
     uint64_t fee, 
-    core_dao_tx_info_t *info
+    core_dao_tx_info_t *info,
+    bool registered_target
     ) {
-    nbgl_layoutTagValue_t pairs[MAX_N_PAIRS];
-    nbgl_layoutTagValueList_t pairList;
+    nbgl_layoutTagValue_t *pairs = review.pairs;
 
     // Format values
-    char *chain_id;
+    const char *chain_id = chain_id_to_string(info->chain_id);
     char *operation_type = NULL;
-    char value_str[32], fee_str[32];
-    char unstake_value_str[32];
-    char delegator_str[40], validator_str[40];
-    char locktime_str[DATETIME_STR_LEN];
-    char core_fee_str[4];
     uint64_t value_spent_abs = value_spent < 0 ? -value_spent : value_spent;
-    format_sats_amount(COIN_COINID_SHORT, value_spent_abs, value_str);
-    format_sats_amount(COIN_COINID_SHORT, fee, fee_str);
-    format_sats_amount(COIN_COINID_SHORT, info->unlock_amount, unstake_value_str);
-    buffer_to_hex(info->delegator, 20, delegator_str, 40);
-    buffer_to_hex(info->validator, 20, validator_str, 40);
-    timestamp_to_string(info->locktime, locktime_str);
-    snprintf(core_fee_str, 4, "%d", info->fee);
-
-    if (info->chain_id == CHAID_ID_MAINNET) {
-        chain_id = (char *)"Mainnet";
-    } else if (info->chain_id == CHAIN_ID_TESTNET) {
-        chain_id = (char *)"Testnet";
-    } else if (info->chain_id == CHAIN_ID_TESTNET2) {
-        chain_id = (char *)"Testnet2";
-    } else {
-        chain_id = (char *)"Unknown";
-    }
+    format_sats_amount(COIN_COINID_SHORT, value_spent_abs, review.value_str);
+    format_sats_amount(COIN_COINID_SHORT, fee, review.fee_str);
+    format_sats_amount(COIN_COINID_SHORT, info->unlock_amount, review.unstake_value_str);
+    buffer_to_hex(info->delegator, 20, review.delegator_str, ADDRESS_STR_LEN);
+    buffer_to_hex(info->validator, 20, review.validator_str, ADDRESS_STR_LEN);
+    timestamp_to_string(info->locktime, review.locktime_str);
+    snprintf(review.core_fee_str, sizeof(review.core_fee_str), "%d", info->fee);
 
     if (info->type & TYPE_TX_LOCK && info->type & TYPE_TX_UNLOCK) {
         operation_type = (char *)"Restake";
@@ -73,26 +102,37 @@ bool display_transaction(
     if (info->type & TYPE_TX_LOCK) {
         pairs[n_pairs++] = (nbgl_layoutTagValue_t){
             .item = "Stake amount",
-            .value = value_str,
+            .value = review.value_str,
         };
     }
 
     if (info->type & TYPE_TX_UNLOCK) {
         pairs[n_pairs++] = (nbgl_layoutTagValue_t){
             .item = "Unstake amount",
-            .value = unstake_value_str,
+            .value = review.unstake_value_str,
         };
     }
 
-    if (info->type & TYPE_TX_LOCK) {
+    if (info->type & TYPE_TX_LOCK && registered_target) {
+        // Delegator, validator, network and Core fee were checked against a registered target
+        pairs[n_pairs++] = (nbgl_layoutTagValue_t){
+            .item = "Staking target",
+            .value = "Registered",
+        };
+
+        pairs[n_pairs++] = (nbgl_layoutTagValue_t){
+            .item = "Locktime (UTC+0)",
+            .value = review.locktime_str,
+        };
+    } else if (info->type & TYPE_TX_LOCK) {
         pairs[n_pairs++] = (nbgl_layoutTagValue_t){
             .item = "Delegator",
-            .value = delegator_str,
+            .value = review.delegator_str,
         };
 
         pairs[n_pairs++] = (nbgl_layoutTagValue_t){
             .item = "Validator",
-            .value = delegator_str,
+            .value = review.validator_str,
             .forcePageStart = true
         };
 
@@ -103,19 +143,19 @@ bool display_transaction(
 
         pairs[n_pairs++] = (nbgl_layoutTagValue_t){
             .item = "Locktime (UTC+0)",
-            .value = locktime_str,
+            .value = review.locktime_str,
             .forcePageStart = true
         };
 
         pairs[n_pairs++] = (nbgl_layoutTagValue_t){
             .item = "Core fee",
-            .value = core_fee_str
+            .value = review.core_fee_str
         };
     }
 
     pairs[n_pairs++] = (nbgl_layoutTagValue_t){
         .item = "Fee",
-        .value = fee_str,
+        .value = review.fee_str,
     };
     
 
@@ -123,12 +163,12 @@ bool display_transaction(
 
 
     // Setup list
-    pairList.nbMaxLinesForValue = 0;
-    pairList.nbPairs = n_pairs;
-    pairList.pairs = pairs;
+    review.pair_list.nbMaxLinesForValue = 0;
+    review.pair_list.nbPairs = n_pairs;
+    review.pair_list.pairs = pairs;
 
     nbgl_useCaseReview(TYPE_TRANSACTION,
-                       &pairList,
+                       &review.pair_list,
                        &C_App_64px,
                        "Review CoreDAO\ntransaction",
                        NULL,
@@ -143,4 +183,102 @@ bool display_transaction(
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+bool display_staking_target(dispatcher_context_t *dc, const staking_target_t *target) {
+    nbgl_layoutTagValue_t *pairs = review.pairs;
+
+    buffer_to_hex((uint8_t *) target->delegator, 20, review.delegator_str, ADDRESS_STR_LEN);
+    buffer_to_hex((uint8_t *) target->validator, 20, review.validator_str, ADDRESS_STR_LEN);
+    snprintf(review.core_fee_str, sizeof(review.core_fee_str), "%d", target->max_fee);
+
+    int n_pairs = 0;
+    pairs[n_pairs++] = (nbgl_layoutTagValue_t){
+        .item = "Delegator",
+        .value = review.delegator_str,
+    };
+
+    pairs[n_pairs++] = (nbgl_layoutTagValue_t){
+        .item = "Validator",
+        .value = review.validator_str,
+        .forcePageStart = true
+    };
+
+    pairs[n_pairs++] = (nbgl_layoutTagValue_t){
+        .item = "Network",
+        .value = chain_id_to_string(target->chain_id),
+    };
+
+    pairs[n_pairs++] = (nbgl_layoutTagValue_t){
+        .item = "Max Core fee",
+        .value = review.core_fee_str
+    };
+
+    assert(n_pairs <= MAX_N_PAIRS);
+
+    review.pair_list.nbMaxLinesForValue = 0;
+    review.pair_list.nbPairs = n_pairs;
+    review.pair_list.pairs = pairs;
+
+    nbgl_useCaseReview(TYPE_OPERATION,
+                       &review.pair_list,
+                       &C_App_64px,
+                       "Register CoreDAO\nstaking target",
+                       "Stakes to this target will\nonly show amount, locktime\nand fee",
+                       "Register staking\ntarget?",
+                       registration_choice);
+
+    bool result = io_ui_process(dc);
+    if (!result) {
+        SEND_SW(dc, SW_DENY);
+        return false;
+    }
+
+    return true;
+}
+
+bool display_fee_bump(dispatcher_context_t *dc, uint64_t previous_fee, uint64_t fee) {
+    nbgl_layoutTagValue_t *pairs = review.pairs;
+
+    // The previous fee takes the place of the amount
+    format_sats_amount(COIN_COINID_SHORT, previous_fee, review.value_str);
+    format_sats_amount(COIN_COINID_SHORT, fee, review.fee_str);
+
+    int n_pairs = 0;
+    pairs[n_pairs++] = (nbgl_layoutTagValue_t){
+        .item = "Transaction type",
+        .value = "Fee bump",
+    };
+
+    pairs[n_pairs++] = (nbgl_layoutTagValue_t){
+        .item = "Previous fee",
+        .value = review.value_str,
+    };
+
+    pairs[n_pairs++] = (nbgl_layoutTagValue_t){
+        .item = "New fee",
+        .value = review.fee_str,
+    };
+
+    assert(n_pairs <= MAX_N_PAIRS);
+
+    review.pair_list.nbMaxLinesForValue = 0;
+    review.pair_list.nbPairs = n_pairs;
+    review.pair_list.pairs = pairs;
+
+    nbgl_useCaseReview(TYPE_TRANSACTION,
+                       &review.pair_list,
+                       &C_App_64px,
+                       "Review CoreDAO\nfee bump",
+                       "Replaces the transaction\nyou approved, only the\nfee and change differ",
+                       "Sign CoreDAO\nfee bump?",
+                       review_choice);
+
+    bool result = io_ui_process(dc);
+    if (!result) {
+        SEND_SW(dc, SW_DENY);
+        return false;
+    }
+
+    return true;
+}
@@ -4,5 +4,24 @@
 
 #include "../bitcoin_app_base/src/boilerplate/dispatcher.h"
 #include "core.h"
+#include "staking_target.h"
 
-bool display_transaction(dispatcher_context_t *dc, int64_t value_spent, uint64_t fee, core_dao_tx_info_t *info);
+// Buffers of the transaction validation. They are not used anymore when the review is displayed,
+// so they share their memory with the review strings.
+typedef struct {
+    uint8_t script_pubkey[SCRIPT_PUBKEY_BUFFER_LEN];
+    uint8_t redeem_script[REDEEM_SCRIPT_LEN];
+    uint8_t lock_script_pubkey[LOCK_SCRIPT_LEN];
+} validation_buffers_t;
+
+extern validation_buffers_t *const validation_buffers;
+
+bool display_transaction(dispatcher_context_t *dc,
+                         int64_t value_spent,
+                         uint64_t fee,
+                         core_dao_tx_info_t *info,
+                         bool registered_target);
+
+bool display_staking_target(dispatcher_context_t *dc, const staking_target_t *target);
+
+bool display_fee_bump(dispatcher_context_t *dc, uint64_t previous_fee, uint64_t fee);
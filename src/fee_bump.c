@@ -0,0 +1,92 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fee_bump.h"
+#include "debug.h"
+
+#include "../bitcoin_app_base/src/common/write.h"
+
+#include "cx.h"
+
+static cx_sha256_t digest_context;
+static uint8_t current_digest[FEE_BUMP_DIGEST_LEN];
+
+static struct {
+    bool valid;
+    uint8_t digest[FEE_BUMP_DIGEST_LEN];
+    uint8_t txid[32];
+    uint64_t fee;
+    uint32_t vout;
+    uint8_t n_bumps;
+} approved;
+
+void fee_bump_digest_init(void) {
+    cx_sha256_init(&digest_context);
+    explicit_bzero(current_digest, sizeof(current_digest));
+}
+
+void fee_bump_digest_add_output(uint64_t amount, const uint8_t *script, size_t script_len) {
+    uint8_t buffer[8 + 1];
+
+    write_u64_le(buffer, 0, amount);
+    buffer[8] = (uint8_t) script_len;
+    cx_hash_no_throw(&digest_context.header, 0, buffer, sizeof(buffer), NULL, 0);
+    cx_hash_no_throw(&digest_context.header, 0, script, script_len, NULL, 0);
+}
+
+void fee_bump_digest_add_input(const uint8_t txid[static 32], uint32_t vout) {
+    uint8_t buffer[4];
+
+    write_u32_le(buffer, 0, vout);
+    cx_hash_no_throw(&digest_context.header, 0, txid, 32, NULL, 0);
+    cx_hash_no_throw(&digest_context.header, 0, buffer, sizeof(buffer), NULL, 0);
+}
+
+void fee_bump_digest_final(tx_type_t type, uint32_t locktime) {
+    uint8_t buffer[4 + 4];
+
+    write_u32_le(buffer, 0, (uint32_t) type);
+    write_u32_le(buffer, 4, locktime);
+    cx_hash_no_throw(&digest_context.header,
+                     CX_LAST,
+                     buffer,
+                     sizeof(buffer),
+                     current_digest,
+                     FEE_BUMP_DIGEST_LEN);
+}
+
+bool fee_bump_matches(uint64_t fee, uint64_t *previous_fee) {
+    if (!approved.valid || approved.n_bumps >= FEE_BUMP_MAX_BUMPS || fee <= approved.fee ||
+        memcmp(approved.digest, current_digest, FEE_BUMP_DIGEST_LEN) != 0) {
+        return false;
+    }
+    *previous_fee = approved.fee;
+    return true;
+}
+
+bool fee_bump_spends_outpoint(const uint8_t txid[static 32], uint32_t vout) {
+    return approved.valid && approved.vout == vout && memcmp(approved.txid, txid, 32) == 0;
+}
+
+void fee_bump_approve(uint64_t fee, const uint8_t txid[static 32], uint32_t vout) {
+    memcpy(approved.digest, current_digest, FEE_BUMP_DIGEST_LEN);
+    memcpy(approved.txid, txid, 32);
+    approved.vout = vout;
+    approved.fee = fee;
+    approved.n_bumps = 0;
+    approved.valid = true;
+    PRINT("Approved transaction kept for fee bumps\n");
+}
+
+void fee_bump_approve_bump(uint64_t fee) {
+    // The digest and the outpoint are unchanged
+    approved.fee = fee;
+    approved.n_bumps += 1;
+    PRINT("Fee bump %d approved\n", approved.n_bumps);
+}
+
+void fee_bump_clear(void) {
+    explicit_bzero(&approved, sizeof(approved));
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core.h"
+
+#define FEE_BUMP_DIGEST_LEN 32
+// Number of successive fee bumps accepted for an approved transaction
+#define FEE_BUMP_MAX_BUMPS 5
+
+/***
+ * Fee bumps (RBF) of an approved CoreDAO transaction get a minimal confirmation.
+ *
+ * While a transaction is validated, the fields that a replacement must keep are accumulated in a
+ * digest: the non-change outputs (which include the SAT+ payload and the lock output), the
+ * outpoints of the CoreDAO inputs and the transaction locktime. When the user approves the
+ * transaction, the digest, the fee and the outpoint spent by its first input are kept in RAM.
+ * A later transaction with the same digest and a higher fee, that spends this outpoint, conflicts
+ * with the approved one and only differs by its fee, change and wallet inputs: only the fee change
+ * is shown. The outpoint is kept across successive bumps, so that they all conflict.
+ */
+
+/***
+ * Start the digest of the transaction being validated
+ */
+void fee_bump_digest_init(void);
+
+/***
+ * Add a non-change output to the digest
+ */
+void fee_bump_digest_add_output(uint64_t amount, const uint8_t *script, size_t script_len);
+
+/***
+ * Add the outpoint spent by a CoreDAO input to the digest
+ */
+void fee_bump_digest_add_input(const uint8_t txid[static 32], uint32_t vout);
+
+/***
+ * Finalize the digest of the validated transaction
+ * @param type The type of the transaction
+ * @param locktime The locktime of the transaction
+ */
+void fee_bump_digest_final(tx_type_t type, uint32_t locktime);
+
+/***
+ * Check if the validated transaction is a fee bump of the last approved one
+ * @param fee The fee of the validated transaction
+ * @param previous_fee The fee of the approved transaction, set if it is a fee bump
+ *
+ * @return true if the digest matches the approved one and the fee increased; the transaction must
+ *         also spend the approved outpoint (see fee_bump_spends_outpoint()) to be a fee bump
+ */
+bool fee_bump_matches(uint64_t fee, uint64_t *previous_fee);
+
+/***
+ * Check if an outpoint is the one spent by the first input of the approved transaction
+ * @param txid The txid of the outpoint
+ * @param vout The output index of the outpoint
+ *
+ * @return true if a fee bump spending this outpoint conflicts with the approved transaction
+ */
+bool fee_bump_spends_outpoint(const uint8_t txid[static 32], uint32_t vout);
+
+/***
+ * Remember the validated transaction as approved by the user, replacing the previous one
+ * @param fee The approved fee
+ * @param txid The txid of the outpoint spent by the first input
+ * @param vout The output index of the outpoint spent by the first input
+ */
+void fee_bump_approve(uint64_t fee, const uint8_t txid[static 32], uint32_t vout);
+
+/***
+ * Remember the validated transaction as approved by the user as a fee bump of the previous one
+ * @param fee The approved fee
+ */
+void fee_bump_approve_bump(uint64_t fee);
+
+/***
+ * Forget the approved transaction
+ */
+void fee_bump_clear(void);
@@ -12,20 +12,73 @@
 #include "display.h"
 #include "debug.h"
 #include "core.h"
+#include "fee_bump.h"
+#include "stack_profile.h"
+#include "staking_target.h"
 
 #define FLAG_OP_RETURN_FOUND 0x01
 #define FLAG_LOCKING_OUTPUT_FOUND 0x01 << 1
 #define FLAG_CHANGE_OUTPUT_FOUND 0x01 << 2
 
-#define SCRIPT_PUBKEY_BUFFER_LEN 83 // Max length for OP_RETURN scriptPubKey
 # define P2TR_SCRIPTPUBKEY_LEN 34
 
+// Custom APDUs (CLA 0xE1, instructions above the ones of the base app)
+#define INS_CORE_GET_LAST_ERROR  0x83
+#define INS_CORE_REGISTER_TARGET 0x84
+#define INS_CORE_USE_TARGET      0x85
+
 static core_dao_tx_info_t core_tx_info;
 
-// No custom APDU
+static bool handle_custom_apdu(dispatcher_context_t *dc, const command_t *cmd) {
+    uint8_t error_detail[CORE_ERROR_DETAIL_LEN];
+    uint8_t hmac[STAKING_TARGET_HMAC_LEN];
+    staking_target_t target;
+
+    // An armed target is only meant for the sign_psbt request that directly follows
+    if (cmd->ins != INS_CORE_USE_TARGET) {
+        staking_target_disarm();
+    }
+
+    switch (cmd->ins) {
+        case INS_CORE_GET_LAST_ERROR:
+            // Reason of the last rejected sign_psbt request, reported only once
+            core_error_serialize(error_detail);
+            core_error_clear();
+            SEND_RESPONSE(dc, error_detail, sizeof(error_detail), SW_OK);
+            return true;
+        case INS_CORE_REGISTER_TARGET:
+            // data: serialized staking target; returns its registration HMAC once approved
+            if (!staking_target_parse(cmd->data, cmd->lc, &target)) {
+                SEND_SW(dc, SW_INCORRECT_DATA);
+            } else if (display_staking_target(dc, &target)) {
+                if (!staking_target_compute_hmac(&target, hmac)) {
+                    SEND_SW(dc, SW_BAD_STATE);
+                } else {
+                    SEND_RESPONSE(dc, hmac, sizeof(hmac), SW_OK);
+                }
+            }
+            return true;
+        case INS_CORE_USE_TARGET:
+            // data: serialized staking target | registration HMAC, used by the next sign_psbt
+            if (cmd->lc != STAKING_TARGET_SERIALIZED_LEN + STAKING_TARGET_HMAC_LEN ||
+                !staking_target_parse(cmd->data, STAKING_TARGET_SERIALIZED_LEN, &target)) {
+                SEND_SW(dc, SW_INCORRECT_DATA);
+            } else if (!staking_target_arm(&target, cmd->data + STAKING_TARGET_SERIALIZED_LEN)) {
+                SEND_SW(dc, SW_SIGNATURE_FAIL);
+            } else {
+                SEND_SW(dc, SW_OK);
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
 bool custom_apdu_handler(dispatcher_context_t *dc, const command_t *cmd) {
-    UNUSED(dc), UNUSED(cmd);
-    return false;
+    STACK_PROFILE_BEGIN("custom_apdu_handler");
+    bool handled = handle_custom_apdu(dc, cmd);
+    STACK_PROFILE_END();
+    return handled;
 }
 
 static bool get_output_amount(
@@ -85,6 +138,63 @@ static bool get_utxo_witness(
     return true;
 }
 
+static bool get_input_outpoint(
+    dispatcher_context_t *dc,
+    merkleized_map_commitment_t *map,
+    uint8_t txid[static 32],
+    uint32_t *vout
+) {
+    uint8_t raw_vout[4];
+    if (32 != call_get_merkleized_map_value(dc,
+                                            map,
+                                            (uint8_t[]){PSBT_IN_PREVIOUS_TXID},
+                                            sizeof((uint8_t[]){PSBT_IN_PREVIOUS_TXID}),
+                                            txid,
+                                            32) ||
+        4 != call_get_merkleized_map_value(dc,
+                                           map,
+                                           (uint8_t[]){PSBT_IN_OUTPUT_INDEX},
+                                           sizeof((uint8_t[]){PSBT_IN_OUTPUT_INDEX}),
+                                           raw_vout,
+                                           sizeof(raw_vout))) {
+        PRINT("Unable to get the outpoint of the input\n");
+        return false;
+    }
+    *vout = read_u32_le(raw_vout, 0);
+    return true;
+}
+
+static bool get_input_outpoint_at(
+    dispatcher_context_t *dc,
+    sign_psbt_state_t *st,
+    unsigned int index,
+    uint8_t txid[static 32],
+    uint32_t *vout
+) {
+    merkleized_map_commitment_t input_map;
+    if (call_get_merkleized_map(dc, st->inputs_root, st->n_inputs, index, &input_map) < 0) {
+        PRINT("Failed to get input %d\n", index);
+        return false;
+    }
+    return get_input_outpoint(dc, &input_map, txid, vout);
+}
+
+// A fee bump must spend the outpoint of the approved transaction, so that only one can be mined
+static bool spends_approved_outpoint(dispatcher_context_t *dc, sign_psbt_state_t *st) {
+    uint8_t txid[32];
+    uint32_t vout;
+    for (unsigned int i = 0; i < st->n_inputs; i++) {
+        if (!get_input_outpoint_at(dc, st, i, txid, &vout)) {
+            return false;
+        }
+        if (fee_bump_spends_outpoint(txid, vout)) {
+            return true;
+        }
+    }
+    PRINT("Does not spend the outpoint of the approved transaction\n");
+    return false;
+}
+
 static bool get_script_pubkey(
     dispatcher_context_t *dc,
     merkleized_map_commitment_t *map,
@@ -131,28 +241,34 @@ static tx_type_t validate_lock_transaction(
 ) {
     int find = 0;
     merkleized_map_commitment_t external_output_map;
-    uint8_t script_pubkey[SCRIPT_PUBKEY_BUFFER_LEN];
+    // The validation buffers share their memory with the review, which is displayed afterwards
+    uint8_t *script_pubkey = validation_buffers->script_pubkey;
     int script_pubkey_len;
-    uint8_t redeem_script[REDEEM_SCRIPT_LEN];
+    uint8_t *redeem_script = validation_buffers->redeem_script;
     size_t redeem_script_len = REDEEM_SCRIPT_LEN;
-    uint8_t lock_script_pubkey[LOCK_SCRIPT_LEN];
+    uint8_t *lock_script_pubkey = validation_buffers->lock_script_pubkey;
+    unsigned int lock_output_index = 0;
+    unsigned int op_return_output_index = 0;
 
     // Iterate through all outputs
     for (unsigned int i = 0; i < st->n_outputs; i++) {
         PRINT("Checking output %d\n", i);
         if (call_get_merkleized_map(dc, st->outputs_root, st->n_outputs, i, &external_output_map) < 0) {
-            PRINT("Failed to get input\n");
+            PRINT("Failed to get output %d\n", i);
+            core_error_set(CORE_ERR_MAP_UNREADABLE, CORE_ERR_LOC_OUTPUT, i);
             return TYPE_TX_INVALID;
         }
         // Get output amount
         uint64_t amount;
         if (!get_output_amount(dc, &external_output_map, &amount)) {
+            core_error_set(CORE_ERR_OUTPUT_MISSING_FIELD, CORE_ERR_LOC_OUTPUT, i);
             return TYPE_TX_INVALID;
         }
         // Get output scriptPubKey
         if (!get_script_pubkey(dc, &external_output_map, script_pubkey,
-                               sizeof(script_pubkey), &script_pubkey_len)) {
+                               SCRIPT_PUBKEY_BUFFER_LEN, &script_pubkey_len)) {
             PRINT("Failed to get scriptPubKey for output %d\n", i);
+            core_error_set(CORE_ERR_OUTPUT_MISSING_FIELD, CORE_ERR_LOC_OUTPUT, i);
             return TYPE_TX_INVALID;
         }
         if (script_pubkey[0] == OP_RETURN) {
@@ -162,22 +278,30 @@ static tx_type_t validate_lock_transaction(
                                            redeem_script) || amount != 0) {
                 PRINT_HEX(script_pubkey, script_pubkey_len, "OP_RETURN scriptPubKey: ");
                 PRINT("Invalid OP_RETURN output or amount is not at zero\n");
+                core_error_set(CORE_ERR_OP_RETURN_AMOUNT, CORE_ERR_LOC_OUTPUT, i);
+                core_error_set_location(CORE_ERR_LOC_OUTPUT, i);
                 SEND_SW(dc, SW_INCORRECT_DATA);
                 return TYPE_TX_INVALID;
             }
+            op_return_output_index = i;
             find |= FLAG_OP_RETURN_FOUND;
         } else if (bitvector_get(internal_outputs, i) == 1) {
             // If the output is internal, consider it to be the change
             find |= FLAG_CHANGE_OUTPUT_FOUND;
+            continue;
         } else {
             if (script_pubkey_len != LOCK_SCRIPT_LEN) {
-                PRINT("Invalid scriptPubKey length for locking output (%d)\n", i);
+                PRINT("Unexpected external output (%d)\n", i);
+                core_error_set(CORE_ERR_UNEXPECTED_OUTPUT, CORE_ERR_LOC_OUTPUT, i);
                 SEND_SW(dc, SW_INCORRECT_DATA);
                 return TYPE_TX_INVALID;
             }
             memcpy(lock_script_pubkey, script_pubkey, LOCK_SCRIPT_LEN);
+            lock_output_index = i;
             find |= FLAG_LOCKING_OUTPUT_FOUND;
         }
+        // A fee bump may only change the change output
+        fee_bump_digest_add_output(amount, script_pubkey, script_pubkey_len);
     }
     
     // If a lock output and a valid op return was found the tx is a staking tx
@@ -191,6 +315,7 @@ static tx_type_t validate_lock_transaction(
 
     if (info->type & TYPE_TX_LOCK && (st->n_outputs < 2 || st->n_outputs > 3)) {
         PRINT("Invalid number of outputs\n");
+        core_error_set(CORE_ERR_OUTPUT_COUNT, CORE_ERR_LOC_NONE, st->n_outputs);
         SEND_SW(dc, SW_INCORRECT_DATA);
         return TYPE_TX_INVALID;
     }
@@ -207,6 +332,7 @@ static tx_type_t validate_lock_transaction(
     // Verify the redeem script contains the expected public key
     if (!validate_redeem_script(redeem_script)) {
         PRINT("Invalid redeem script in OP_RETURN output\n");
+        core_error_set(CORE_ERR_REDEEM_SCRIPT, CORE_ERR_LOC_OUTPUT, op_return_output_index);
         SEND_SW(dc, SW_INCORRECT_DATA);
         return TYPE_TX_INVALID;
     }
@@ -214,6 +340,7 @@ static tx_type_t validate_lock_transaction(
     // Verify the lock output uses the right redeem script
     if (!validate_lock_script_pubkey(lock_script_pubkey, LOCK_SCRIPT_LEN, redeem_script)) {
         PRINT("Invalid scriptPubKey for the lock output\n");
+        core_error_set(CORE_ERR_LOCK_SCRIPT, CORE_ERR_LOC_OUTPUT, lock_output_index);
         SEND_SW(dc, SW_INCORRECT_DATA);
         return TYPE_TX_INVALID;
     }
@@ -238,28 +365,40 @@ static tx_type_t validate_unlock_transaction(
             // Get commitment to the i-th input's map
             PRINT("Getting input %d\n", i);
             if (call_get_merkleized_map(dc, st->inputs_root, st->n_inputs, i, &external_input_map) < 0) {
-                PRINT("Failed to get input &d\n", i);
+                PRINT("Failed to get input %d\n", i);
+                core_error_set(CORE_ERR_MAP_UNREADABLE, CORE_ERR_LOC_INPUT, i);
                 return TYPE_TX_INVALID;
             }
             // Get input amount and redeem script
             uint64_t amount;
             uint8_t redeem_script_hash[SCRIPT_HASH_LEN];
             uint8_t redeem_script[REDEEM_SCRIPT_LEN];
+            uint8_t prev_txid[32];
+            uint32_t prev_vout;
 
             if (!get_utxo_witness(dc, &external_input_map, &amount, redeem_script_hash)) {
+                core_error_set(CORE_ERR_INPUT_WITNESS_UTXO, CORE_ERR_LOC_INPUT, i);
+                return TYPE_TX_INVALID;
+            }
+
+            if (!get_input_outpoint(dc, &external_input_map, prev_txid, &prev_vout)) {
+                core_error_set(CORE_ERR_INPUT_OUTPOINT, CORE_ERR_LOC_INPUT, i);
                 return TYPE_TX_INVALID;
             }
 
             if (!get_input_redeem_script(dc, &external_input_map, redeem_script, REDEEM_SCRIPT_LEN)) {
+                core_error_set(CORE_ERR_INPUT_WITNESS_SCRIPT, CORE_ERR_LOC_INPUT, i);
                 return TYPE_TX_INVALID;
             }
 
             // Check if the redeem script is a valid CoreDAO redeem script
             if (!validate_redeem_script(redeem_script)) {
                 PRINT("Invalid redeem script in input %d\n", i);
+                core_error_set(CORE_ERR_REDEEM_SCRIPT, CORE_ERR_LOC_INPUT, i);
                 return TYPE_TX_INVALID;
             }
 
+            fee_bump_digest_add_input(prev_txid, prev_vout);
             info->type |= TYPE_TX_UNLOCK;
             info->n_core_dao_inputs += 1;
             info->unlock_amount += amount;
@@ -297,8 +436,7 @@ static tx_type_t validate_transaction(
     return tx_type;
 }
 
-// hooking into a weak function
-bool validate_and_display_transaction(
+static bool review_transaction(
     dispatcher_context_t *dc,
     sign_psbt_state_t *st,
     const uint8_t internal_inputs[64],
@@ -307,39 +445,80 @@ bool validate_and_display_transaction(
 
 
     explicit_bzero(&core_tx_info, sizeof(core_tx_info));
+    core_error_clear();
+    fee_bump_digest_init();
 
     tx_type_t tx_type = validate_transaction(dc, st, internal_inputs, internal_outputs, &core_tx_info);
 
     if ((tx_type & TYPE_TX_INVALID) == TYPE_TX_INVALID) {
         PRINT("Send invalid status\n");
+        staking_target_disarm();
         SEND_SW(dc, SW_INCORRECT_DATA);
         return false;
     }
 
+    fee_bump_digest_final(core_tx_info.type, st->locktime);
+
     // the amount spent from the wallet policy (or negative if the it received more funds than it spent)
     int64_t internal_value = st->internal_inputs_total_amount + 
                              core_tx_info.unlock_amount -
                              st->outputs.change_total_amount;
 
     uint64_t fee = st->inputs_total_amount - st->outputs.total_amount;
+    uint64_t previous_fee;
+    uint8_t first_txid[32];
+    uint32_t first_vout;
+
+    // A registered target is only valid for a single request
+    bool registered_target = (core_tx_info.type & TYPE_TX_LOCK) &&
+                             staking_target_matches(&core_tx_info);
+    staking_target_disarm();
 
-    if (!display_transaction(dc, internal_value, fee, &core_tx_info)) {
+    // Replacement of the last approved transaction, only its fee and change changed
+    bool is_fee_bump = fee_bump_matches(fee, &previous_fee) && spends_approved_outpoint(dc, st);
+
+    if (is_fee_bump) {
+        if (!display_fee_bump(dc, previous_fee, fee)) {
+            return false;
+        }
+        fee_bump_approve_bump(fee);
+        return true;
+    }
+
+    // Outpoint that the fee bumps of this transaction will have to spend
+    bool has_outpoint = get_input_outpoint_at(dc, st, 0, first_txid, &first_vout);
+
+    if (!display_transaction(dc, internal_value, fee, &core_tx_info, registered_target)) {
         return false;
     }
 
+    if (has_outpoint) {
+        fee_bump_approve(fee, first_txid, first_vout);
+    } else {
+        fee_bump_clear();
+    }
     return true;
 }
 
+// hooking into a weak function
+bool validate_and_display_transaction(
+    dispatcher_context_t *dc,
+    sign_psbt_state_t *st,
+    const uint8_t internal_inputs[64],
+    const uint8_t internal_outputs[64]) {
+    STACK_PROFILE_BEGIN("validate_and_display_transaction");
+    bool result = review_transaction(dc, st, internal_inputs, internal_outputs);
+    STACK_PROFILE_END();
+    return result;
+}
+
 
-bool sign_custom_inputs(
+static bool sign_core_inputs(
     dispatcher_context_t *dc,
     sign_psbt_state_t *st,
-    tx_hashes_t *tx_hashes,
-    const uint8_t internal_inputs[static BITVECTOR_REAL_SIZE(MAX_N_INPUTS_CAN_SIGN)]) {
-    UNUSED(dc), UNUSED(st), UNUSED(tx_hashes), UNUSED(internal_inputs);
+    tx_hashes_t *tx_hashes) {
     merkleized_map_commitment_t input_map;
     uint8_t sighash[32];
-    uint8_t redeem_script[REDEEM_SCRIPT_LEN];
     uint32_t path[] = CORE_DERIVATION_PATH;
     uint64_t amount;
     uint8_t script_pubkey[2 + SCRIPT_HASH_LEN];
@@ -349,12 +528,14 @@ bool sign_custom_inputs(
             PRINT("Signing input %d\n", i);
             // Get the commitment to the i-th input's map
             if (call_get_merkleized_map(dc, st->inputs_root, st->n_inputs, i, &input_map) < 0) {
-                PRINT("Failed to get input &d\n", i);
+                PRINT("Failed to get input %d\n", i);
+                core_error_set(CORE_ERR_MAP_UNREADABLE, CORE_ERR_LOC_INPUT, i);
                 SEND_SW(dc, SW_INCORRECT_DATA);
                 return false;
             }
             // Get the redeem script
             if (!get_utxo_witness(dc, &input_map, &amount, script_pubkey + 2)) {
+                core_error_set(CORE_ERR_INPUT_WITNESS_UTXO, CORE_ERR_LOC_INPUT, i);
                 SEND_SW(dc, SW_INCORRECT_DATA);
                 return false;
             }
@@ -373,6 +554,7 @@ bool sign_custom_inputs(
                 sighash
             )) {
                 PRINT("Failed to compute the sighash\n");
+                core_error_set(CORE_ERR_SIGNING, CORE_ERR_LOC_INPUT, i);
                 return false;
             }
             if (!sign_sighash_ecdsa_and_yield(
@@ -384,9 +566,22 @@ bool sign_custom_inputs(
                 SIGHASH_DEFAULT,
                 sighash)) {
                 PRINT("Signing failed\n");
+                core_error_set(CORE_ERR_SIGNING, CORE_ERR_LOC_INPUT, i);
                 return false;
             }
         }
     }
     return true;
+}
+
+bool sign_custom_inputs(
+    dispatcher_context_t *dc,
+    sign_psbt_state_t *st,
+    tx_hashes_t *tx_hashes,
+    const uint8_t internal_inputs[static BITVECTOR_REAL_SIZE(MAX_N_INPUTS_CAN_SIGN)]) {
+    UNUSED(internal_inputs);
+    STACK_PROFILE_BEGIN("sign_custom_inputs");
+    bool result = sign_core_inputs(dc, st, tx_hashes);
+    STACK_PROFILE_END();
+    return result;
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifdef HAVE_CORE_STACK_PROFILING
+
+#include <stdint.h>
+
+#include "stack_profile.h"
+#include "debug.h"
+
+#define STACK_PAINT_PATTERN 0xC0DAC0DAu
+// Bytes left untouched below the current stack pointer: the frame of stack_profile_begin()
+// itself and the calls it makes
+#define STACK_PAINT_MARGIN 128
+
+// Bounds of the application stack, defined by the SDK linker script
+extern uint32_t _stack;
+extern uint32_t _estack;
+
+static uintptr_t current_sp(void) {
+    volatile uint32_t marker = 0;
+    return (uintptr_t) &marker;
+}
+
+void stack_profile_begin(stack_profile_t *profile, const char *name) {
+    // Skip the first word, which holds the stack canary of the SDK
+    uint32_t *bottom = &_stack + 1;
+    uint32_t *limit = (uint32_t *) ((current_sp() - STACK_PAINT_MARGIN) & ~(uintptr_t) 3);
+
+    profile->name = name;
+    profile->entry_sp = current_sp();
+
+    for (volatile uint32_t *p = bottom; p < limit; p++) {
+        *p = STACK_PAINT_PATTERN;
+    }
+}
+
+void stack_profile_end(const stack_profile_t *profile) {
+    uint32_t *p = &_stack + 1;
+    uint32_t *top = (uint32_t *) &_estack;
+
+    while (p < top && *p == STACK_PAINT_PATTERN) {
+        p++;
+    }
+
+    uintptr_t high_water = (uintptr_t) top - (uintptr_t) p;
+    uintptr_t stack_size = (uintptr_t) top - (uintptr_t) &_stack;
+    uintptr_t hook_usage = profile->entry_sp - (uintptr_t) p;
+
+    PRINT("[STACK] %s: hook %d bytes, high-water %d/%d bytes\n",
+          profile->name,
+          (int) hook_usage,
+          (int) high_water,
+          (int) stack_size);
+}
+
+#endif
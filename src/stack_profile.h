@@ -0,0 +1,44 @@
+#pragma once
+
+/***
+ * Stack high-water mark measurement for the CoreDAO hooks.
+ *
+ * Built only with `make CORE_STACK_PROFILING=1`. At the entry of a hook, the free part of the
+ * stack (between the bottom of the stack and the current stack pointer) is painted with a known
+ * pattern. At the exit, the lowest overwritten word gives the deepest stack usage reached by the
+ * hook and everything it called, which is printed along with the total stack size.
+ */
+
+#ifdef HAVE_CORE_STACK_PROFILING
+
+#include <stdint.h>
+
+typedef struct {
+    const char *name;
+    uintptr_t entry_sp;
+} stack_profile_t;
+
+/***
+ * Paint the unused stack below the caller's frame
+ * @param profile The profile to start
+ * @param name The name of the hook, used in the report
+ */
+void stack_profile_begin(stack_profile_t *profile, const char *name);
+
+/***
+ * Report the deepest stack usage since stack_profile_begin()
+ * @param profile The profile started at the hook entry
+ */
+void stack_profile_end(const stack_profile_t *profile);
+
+#define STACK_PROFILE_BEGIN(name)   \
+    stack_profile_t stack_profile_; \
+    stack_profile_begin(&stack_profile_, name)
+#define STACK_PROFILE_END() stack_profile_end(&stack_profile_)
+
+#else
+
+#define STACK_PROFILE_BEGIN(name) // Nothing
+#define STACK_PROFILE_END()       // Nothing
+
+#endif
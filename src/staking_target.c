@@ -0,0 +1,92 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "staking_target.h"
+#include "debug.h"
+
+#include "../bitcoin_app_base/src/crypto.h"
+#include "../bitcoin_app_base/src/common/wallet.h"
+#include "../bitcoin_app_base/src/common/read.h"
+#include "../bitcoin_app_base/src/common/write.h"
+
+#include "cx.h"
+#include "os.h"
+
+// Prefix of the message authenticated with the wallet policy key (the only SLIP-21 key the app is
+// allowed to derive), so that a target HMAC can never be a wallet policy HMAC
+static const char STAKING_TARGET_DOMAIN[] = "CoreDAO staking target";
+
+#define STAKING_TARGET_MESSAGE_LEN (sizeof(STAKING_TARGET_DOMAIN) - 1 + STAKING_TARGET_SERIALIZED_LEN)
+
+static staking_target_t armed_target;
+static bool target_armed = false;
+
+bool staking_target_parse(const uint8_t *data, size_t data_len, staking_target_t *target) {
+    if (data_len != STAKING_TARGET_SERIALIZED_LEN) {
+        return false;
+    }
+    memcpy(target->delegator, data, 20);
+    memcpy(target->validator, data + 20, 20);
+    target->chain_id = read_u16_be(data, 40);
+    target->max_fee = data[42];
+
+    if (target->chain_id != CHAID_ID_MAINNET &&
+        target->chain_id != CHAIN_ID_TESTNET &&
+        target->chain_id != CHAIN_ID_TESTNET2) {
+        PRINT("Unsupported chain id %d\n", target->chain_id);
+        return false;
+    }
+    return true;
+}
+
+bool staking_target_compute_hmac(const staking_target_t *target,
+                                 uint8_t hmac[static STAKING_TARGET_HMAC_LEN]) {
+    uint8_t key[32];
+    uint8_t message[STAKING_TARGET_MESSAGE_LEN];
+    uint8_t *serialized = message + sizeof(STAKING_TARGET_DOMAIN) - 1;
+
+    memcpy(message, STAKING_TARGET_DOMAIN, sizeof(STAKING_TARGET_DOMAIN) - 1);
+    memcpy(serialized, target->delegator, 20);
+    memcpy(serialized + 20, target->validator, 20);
+    write_u16_be(serialized, 40, target->chain_id);
+    serialized[42] = target->max_fee;
+
+    if (!crypto_derive_symmetric_key(WALLET_SLIP0021_LABEL, WALLET_SLIP0021_LABEL_LEN, key)) {
+        return false;
+    }
+    cx_hmac_sha256(key, sizeof(key), message, sizeof(message), hmac, STAKING_TARGET_HMAC_LEN);
+    explicit_bzero(key, sizeof(key));
+    return true;
+}
+
+bool staking_target_arm(const staking_target_t *target,
+                        const uint8_t hmac[static STAKING_TARGET_HMAC_LEN]) {
+    uint8_t expected_hmac[STAKING_TARGET_HMAC_LEN];
+
+    staking_target_disarm();
+    if (!staking_target_compute_hmac(target, expected_hmac)) {
+        return false;
+    }
+    if (os_secure_memcmp(expected_hmac, hmac, STAKING_TARGET_HMAC_LEN) != 0) {
+        PRINT("Invalid staking target HMAC\n");
+        return false;
+    }
+    memcpy(&armed_target, target, sizeof(armed_target));
+    target_armed = true;
+    return true;
+}
+
+bool staking_target_matches(const core_dao_tx_info_t *info) {
+    return target_armed &&
+           info->chain_id == armed_target.chain_id &&
+           info->fee <= armed_target.max_fee &&
+           memcmp(info->delegator, armed_target.delegator, 20) == 0 &&
+           memcmp(info->validator, armed_target.validator, 20) == 0;
+}
+
+void staking_target_disarm(void) {
+    explicit_bzero(&armed_target, sizeof(armed_target));
+    target_armed = false;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core.h"
+
+// DELEGATOR(20) + VALIDATOR(20) + CHAIN_ID(2) + MAX_CORE_FEE(1)
+#define STAKING_TARGET_SERIALIZED_LEN 43
+#define STAKING_TARGET_HMAC_LEN       32
+
+/***
+ * A staking target registered by the user. Stakes matching a registered target get a condensed
+ * review, as the delegator, validator, network and Core fee were already verified on the device.
+ */
+typedef struct {
+    uint8_t delegator[20];
+    uint8_t validator[20];
+    uint16_t chain_id;
+    uint8_t max_fee;
+} staking_target_t;
+
+/***
+ * Parse a serialized staking target: delegator | validator | chain_id (big-endian) | max Core fee
+ * @param data The serialized target
+ * @param data_len The length of the serialized target
+ * @param target The parsed target
+ *
+ * @return true if the target is well formed and on a supported chain, false otherwise
+ */
+bool staking_target_parse(const uint8_t *data, size_t data_len, staking_target_t *target);
+
+/***
+ * Compute the registration HMAC of a target, with a key derived from the seed
+ * @param target The target to authenticate
+ * @param hmac The computed HMAC
+ *
+ * @return true on success, false otherwise
+ */
+bool staking_target_compute_hmac(const staking_target_t *target,
+                                 uint8_t hmac[static STAKING_TARGET_HMAC_LEN]);
+
+/***
+ * Use a registered target for the review of the next validated sign_psbt request; any other
+ * CoreDAO APDU sent before it disarms the target
+ * @param target The registered target
+ * @param hmac The HMAC returned at registration
+ *
+ * @return true if the HMAC is valid, false otherwise
+ */
+bool staking_target_arm(const staking_target_t *target,
+                        const uint8_t hmac[static STAKING_TARGET_HMAC_LEN]);
+
+/***
+ * Check if the stake of a transaction matches the armed registered target
+ * @param info The validated transaction information
+ *
+ * @return true if the delegator, validator and chain id match and the Core fee is within bounds
+ */
+bool staking_target_matches(const core_dao_tx_info_t *info);
+
+/***
+ * Forget the armed target; a target is used for a single validated sign_psbt request
+ */
+void staking_target_disarm(void);
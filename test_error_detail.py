@@ -0,0 +1,69 @@
+from ledger_bitcoin import Chain, TransportClient, WalletPolicy
+from ledger_bitcoin.client import NewClient as AppClient
+from ledger_bitcoin.psbt import PSBT
+
+
+CLA_APP = 0xE1
+INS_CORE_GET_LAST_ERROR = 0x83
+
+LOCATION_OUTPUT = 2
+CORE_ERR_SAT_PREFIX = 2
+CORE_ERR_LOCK_SCRIPT = 7
+
+# The PSBT of test_stake.py, with "SAT-" instead of "SAT+" in the OP_RETURN payload (output 1)
+PSBT_BAD_PREFIX = "cHNidP8BAgQCAAAAAQMEAAAAAAEEAQEBBQECAfsEAgAAAAABAMACAAAAAAEBkteTU5STYpaazD6mm2dBYgUIh1J35DYGPfH2tMV/iEEAAAAAAP////8BgDl6EgAAAAAWABQTR+gqA3tduzjPjEdZ8kKx9cfgmgJIMEUCIQCJ2mCr7T1A+h807JBkjVqj1lbKUoEB7FVqyeQUkbiW4AIgC1q0vsCiDGu2zqgACafrg3XsPsWPIJk6VIeB9iedgEcBIQM90rAt3EwCSzePotxDq2uBMYtEizXhd7qP26TzCQZ8IAAAAAABAR+AOXoSAAAAABYAFBNH6CoDe127OM+MR1nyQrH1x+CaIgYCfLddNLAFxOufYrvyxFfXY46BPnV+/OyPpoZ32VC2NmIY9azC/VQAAIABAACAAAAAgAAAAAAAAAAAAQ4g+tXQt6sxuPtHpWZY8En2c8OATtJN2KKxR6oZk+bvLvUBDwQAAAAAARAE/f///wABAwgAo+ERAAAAAAEEIgAg2uIp+SyXvQOY3oP3uxjVR//gdKU0sMqrEm3GdzuJDTQAAQMIAAAAAAAAAAABBFNqTFBTQVQtAQRb3mC30Oa3WMpd2MYdN3osXxr1HsGp4gn16gA2yML0EHijzr7lfYpH1QEEH14OZrF1dqkUE0foKgN7Xbs4z4xHWfJCsfXH4JqIrAA="
+# The PSBT of test_stake.py, with the last byte of the P2WSH lock output (output 0) flipped
+PSBT_BAD_LOCK = "cHNidP8BAgQCAAAAAQMEAAAAAAEEAQEBBQECAfsEAgAAAAABAMACAAAAAAEBkteTU5STYpaazD6mm2dBYgUIh1J35DYGPfH2tMV/iEEAAAAAAP////8BgDl6EgAAAAAWABQTR+gqA3tduzjPjEdZ8kKx9cfgmgJIMEUCIQCJ2mCr7T1A+h807JBkjVqj1lbKUoEB7FVqyeQUkbiW4AIgC1q0vsCiDGu2zqgACafrg3XsPsWPIJk6VIeB9iedgEcBIQM90rAt3EwCSzePotxDq2uBMYtEizXhd7qP26TzCQZ8IAAAAAABAR+AOXoSAAAAABYAFBNH6CoDe127OM+MR1nyQrH1x+CaIgYCfLddNLAFxOufYrvyxFfXY46BPnV+/OyPpoZ32VC2NmIY9azC/VQAAIABAACAAAAAgAAAAAAAAAAAAQ4g+tXQt6sxuPtHpWZY8En2c8OATtJN2KKxR6oZk+bvLvUBDwQAAAAAARAE/f///wABAwgAo+ERAAAAAAEEIgAg2uIp+SyXvQOY3oP3uxjVR//gdKU0sMqrEm3GdzuJDTUAAQMIAAAAAAAAAAABBFNqTFBTQVQrAQRb3mC30Oa3WMpd2MYdN3osXxr1HsGp4gn16gA2yML0EHijzr7lfYpH1QEEH14OZrF1dqkUE0foKgN7Xbs4z4xHWfJCsfXH4JqIrAA="
+
+
+def get_last_error(transport):
+    detail = transport.apdu_exchange(CLA_APP, INS_CORE_GET_LAST_ERROR, b"")
+    assert len(detail) == 6
+    return detail[0], detail[1], int.from_bytes(detail[2:6], "big")
+
+
+def expect_rejection(client, transport, wallet, encoded, expected):
+    psbt = PSBT()
+    psbt.deserialize(encoded)
+    try:
+        client.sign_psbt(psbt, wallet, None)
+    except Exception as e:
+        print("Rejected as expected:", e)
+    else:
+        raise AssertionError("The PSBT should have been rejected")
+
+    error = get_last_error(transport)
+    print("Error detail (code, location, index):", error)
+    assert error == expected, f"expected {expected}"
+
+    # The reason is only reported once
+    assert get_last_error(transport) == (0, 0, 0)
+
+
+if __name__ == '__main__':
+    transport = TransportClient()
+    client = AppClient(transport, chain=Chain.TEST)
+
+    fpr = client.get_master_fingerprint()
+    print(f"Fingerprint: {fpr.hex()}")
+
+    if fpr.hex() != "f5acc2fd":
+        print("This test assumes that the device is onboarded with the default mnemonic of Speculos")
+        client.stop()
+        exit(1)
+
+    wallet = WalletPolicy(
+        "",
+        "wpkh(@0/**)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P"
+        ],
+    )
+
+    expect_rejection(client, transport, wallet, PSBT_BAD_PREFIX,
+                     (CORE_ERR_SAT_PREFIX, LOCATION_OUTPUT, 1))
+    expect_rejection(client, transport, wallet, PSBT_BAD_LOCK,
+                     (CORE_ERR_LOCK_SCRIPT, LOCATION_OUTPUT, 0))
+
+    print("Error detail APDU OK")
+    client.stop()
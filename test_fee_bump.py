@@ -0,0 +1,78 @@
+import json
+import urllib.request
+
+from ledger_bitcoin import Chain, TransportClient, WalletPolicy
+from ledger_bitcoin.client import NewClient as AppClient
+from ledger_bitcoin.psbt import PSBT
+
+
+# Speculos REST API, used to check which review was displayed
+SPECULOS_API = "http://127.0.0.1:5000"
+
+# The stake of test_stake.py with a change output (m/84'/1'/0'/1/0) of 0.09 tBTC: fee 0.01 tBTC
+PSBT_ORIGINAL = "cHNidP8BAgQCAAAAAQMEAAAAAAEEAQEBBQEDAfsEAgAAAAABAMACAAAAAAEBkteTU5STYpaazD6mm2dBYgUIh1J35DYGPfH2tMV/iEEAAAAAAP////8BgDl6EgAAAAAWABQTR+gqA3tduzjPjEdZ8kKx9cfgmgJIMEUCIQCJ2mCr7T1A+h807JBkjVqj1lbKUoEB7FVqyeQUkbiW4AIgC1q0vsCiDGu2zqgACafrg3XsPsWPIJk6VIeB9iedgEcBIQM90rAt3EwCSzePotxDq2uBMYtEizXhd7qP26TzCQZ8IAAAAAABAR+AOXoSAAAAABYAFBNH6CoDe127OM+MR1nyQrH1x+CaIgYCfLddNLAFxOufYrvyxFfXY46BPnV+/OyPpoZ32VC2NmIY9azC/VQAAIABAACAAAAAgAAAAAAAAAAAAQ4g+tXQt6sxuPtHpWZY8En2c8OATtJN2KKxR6oZk+bvLvUBDwQAAAAAARAE/f///wABAwgAo+ERAAAAAAEEIgAg2uIp+SyXvQOY3oP3uxjVR//gdKU0sMqrEm3GdzuJDTQAAQMIAAAAAAAAAAABBFNqTFBTQVQrAQRb3mC30Oa3WMpd2MYdN3osXxr1HsGp4gn16gA2yML0EHijzr7lfYpH1QEEH14OZrF1dqkUE0foKgN7Xbs4z4xHWfJCsfXH4JqIrAAiAgJxtbd5rYcIOFh3l7z28MeuxavnanCdck9I0uJs+HTwoBj1rML9VAAAgAEAAIAAAACAAQAAAAAAAAABAwhAVIkAAAAAAAEEFgAUNcbg3W08hLFrqIXcpzrIY9C1k+wA"
+# Same inputs and outputs, change of 0.08 tBTC: fee 0.02 tBTC
+PSBT_FEE_BUMP = "cHNidP8BAgQCAAAAAQMEAAAAAAEEAQEBBQEDAfsEAgAAAAABAMACAAAAAAEBkteTU5STYpaazD6mm2dBYgUIh1J35DYGPfH2tMV/iEEAAAAAAP////8BgDl6EgAAAAAWABQTR+gqA3tduzjPjEdZ8kKx9cfgmgJIMEUCIQCJ2mCr7T1A+h807JBkjVqj1lbKUoEB7FVqyeQUkbiW4AIgC1q0vsCiDGu2zqgACafrg3XsPsWPIJk6VIeB9iedgEcBIQM90rAt3EwCSzePotxDq2uBMYtEizXhd7qP26TzCQZ8IAAAAAABAR+AOXoSAAAAABYAFBNH6CoDe127OM+MR1nyQrH1x+CaIgYCfLddNLAFxOufYrvyxFfXY46BPnV+/OyPpoZ32VC2NmIY9azC/VQAAIABAACAAAAAgAAAAAAAAAAAAQ4g+tXQt6sxuPtHpWZY8En2c8OATtJN2KKxR6oZk+bvLvUBDwQAAAAAARAE/f///wABAwgAo+ERAAAAAAEEIgAg2uIp+SyXvQOY3oP3uxjVR//gdKU0sMqrEm3GdzuJDTQAAQMIAAAAAAAAAAABBFNqTFBTQVQrAQRb3mC30Oa3WMpd2MYdN3osXxr1HsGp4gn16gA2yML0EHijzr7lfYpH1QEEH14OZrF1dqkUE0foKgN7Xbs4z4xHWfJCsfXH4JqIrAAiAgJxtbd5rYcIOFh3l7z28MeuxavnanCdck9I0uJs+HTwoBj1rML9VAAAgAEAAIAAAACAAQAAAAAAAAABAwgAEnoAAAAAAAEEFgAUNcbg3W08hLFrqIXcpzrIY9C1k+wA"
+# Same outputs, change of 0.07 tBTC, but the wallet input spends another outpoint: it does not
+# conflict with the transactions above
+PSBT_OTHER_INPUTS = "cHNidP8BAgQCAAAAAQMEAAAAAAEEAQEBBQEDAfsEAgAAAAABAMACAAAAAAEBkteTU5STYpaazD6mm2dBYgUIh1J35DYGPfH2tMV/iEEAAAAAAP////8BgDl6EgAAAAAWABQTR+gqA3tduzjPjEdZ8kKx9cfgmgJIMEUCIQCJ2mCr7T1A+h807JBkjVqj1lbKUoEB7FVqyeQUkbiW4AIgC1q0vsCiDGu2zqgACafrg3XsPsWPIJk6VIeB9iedgEcBIQM90rAt3EwCSzePotxDq2uBMYtEizXhd7qP26TzCQZ8IAEAAAABAR+AOXoSAAAAABYAFBNH6CoDe127OM+MR1nyQrH1x+CaIgYCfLddNLAFxOufYrvyxFfXY46BPnV+/OyPpoZ32VC2NmIY9azC/VQAAIABAACAAAAAgAAAAAAAAAAAAQ4gctcxcUA69FSZFWdu7nZMxNzMe5ixePzu3Nf2IRj2m9EBDwQAAAAAARAE/f///wABAwgAo+ERAAAAAAEEIgAg2uIp+SyXvQOY3oP3uxjVR//gdKU0sMqrEm3GdzuJDTQAAQMIAAAAAAAAAAABBFNqTFBTQVQrAQRb3mC30Oa3WMpd2MYdN3osXxr1HsGp4gn16gA2yML0EHijzr7lfYpH1QEEH14OZrF1dqkUE0foKgN7Xbs4z4xHWfJCsfXH4JqIrAAiAgJxtbd5rYcIOFh3l7z28MeuxavnanCdck9I0uJs+HTwoBj1rML9VAAAgAEAAIAAAACAAQAAAAAAAAABAwjAz2oAAAAAAAEEFgAUNcbg3W08hLFrqIXcpzrIY9C1k+wA"
+
+
+def clear_screen_events():
+    urllib.request.urlopen(urllib.request.Request(f"{SPECULOS_API}/events", method="DELETE"))
+
+
+def screen_texts():
+    with urllib.request.urlopen(f"{SPECULOS_API}/events") as response:
+        return [event["text"] for event in json.load(response)["events"]]
+
+
+def sign(client, wallet, encoded):
+    psbt = PSBT()
+    psbt.deserialize(encoded)
+    clear_screen_events()
+    sign_results = client.sign_psbt(psbt, wallet, None)
+    print("Results of sign_psbt:", sign_results)
+    assert len(sign_results) == 1
+    return screen_texts()
+
+
+if __name__ == '__main__':
+    transport = TransportClient()
+    client = AppClient(transport, chain=Chain.TEST)
+
+    fpr = client.get_master_fingerprint()
+    print(f"Fingerprint: {fpr.hex()}")
+
+    if fpr.hex() != "f5acc2fd":
+        print("This test assumes that the device is onboarded with the default mnemonic of Speculos")
+        client.stop()
+        exit(1)
+
+    wallet = WalletPolicy(
+        "",
+        "wpkh(@0/**)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P"
+        ],
+    )
+
+    try:
+        # Full review of the original stake
+        texts = sign(client, wallet, PSBT_ORIGINAL)
+        assert "Stake amount" in texts and "New fee" not in texts, "expected the full review"
+
+        # Same stake, higher fee, same outpoint: fee bump review
+        texts = sign(client, wallet, PSBT_FEE_BUMP)
+        assert "New fee" in texts and "Stake amount" not in texts, "expected the fee bump review"
+
+        # Same stake, higher fee, other outpoint: a second stake, full review
+        texts = sign(client, wallet, PSBT_OTHER_INPUTS)
+        assert "Stake amount" in texts and "New fee" not in texts, "expected the full review"
+    except Exception as e:
+        print("Error:", e)
+        client.stop()
+        exit(1)
+
+    print("Fee bump review OK")
+    client.stop()
@@ -0,0 +1,98 @@
+import json
+import urllib.request
+
+from ledger_bitcoin import Chain, TransportClient, WalletPolicy
+from ledger_bitcoin.client import NewClient as AppClient
+from ledger_bitcoin.psbt import PSBT
+
+
+CLA_APP = 0xE1
+INS_CORE_REGISTER_TARGET = 0x84
+INS_CORE_USE_TARGET = 0x85
+SW_SIGNATURE_FAIL = 0x6982
+
+# Speculos REST API, used to check which review was displayed
+SPECULOS_API = "http://127.0.0.1:5000"
+
+# Target of the stake of test_stake.py: delegator | validator | chain id (testnet) | max Core fee
+TARGET = bytes.fromhex(
+    "de60b7d0e6b758ca5dd8c61d377a2c5f1af51ec1"
+    "a9e209f5ea0036c8c2f41078a3cebee57d8a47d5"
+    "045b"
+    "01"
+)
+
+# The PSBT of test_stake.py
+PSBT_STAKE = "cHNidP8BAgQCAAAAAQMEAAAAAAEEAQEBBQECAfsEAgAAAAABAMACAAAAAAEBkteTU5STYpaazD6mm2dBYgUIh1J35DYGPfH2tMV/iEEAAAAAAP////8BgDl6EgAAAAAWABQTR+gqA3tduzjPjEdZ8kKx9cfgmgJIMEUCIQCJ2mCr7T1A+h807JBkjVqj1lbKUoEB7FVqyeQUkbiW4AIgC1q0vsCiDGu2zqgACafrg3XsPsWPIJk6VIeB9iedgEcBIQM90rAt3EwCSzePotxDq2uBMYtEizXhd7qP26TzCQZ8IAAAAAABAR+AOXoSAAAAABYAFBNH6CoDe127OM+MR1nyQrH1x+CaIgYCfLddNLAFxOufYrvyxFfXY46BPnV+/OyPpoZ32VC2NmIY9azC/VQAAIABAACAAAAAgAAAAAAAAAAAAQ4g+tXQt6sxuPtHpWZY8En2c8OATtJN2KKxR6oZk+bvLvUBDwQAAAAAARAE/f///wABAwgAo+ERAAAAAAEEIgAg2uIp+SyXvQOY3oP3uxjVR//gdKU0sMqrEm3GdzuJDTQAAQMIAAAAAAAAAAABBFNqTFBTQVQrAQRb3mC30Oa3WMpd2MYdN3osXxr1HsGp4gn16gA2yML0EHijzr7lfYpH1QEEH14OZrF1dqkUE0foKgN7Xbs4z4xHWfJCsfXH4JqIrAA="
+
+
+def clear_screen_events():
+    urllib.request.urlopen(urllib.request.Request(f"{SPECULOS_API}/events", method="DELETE"))
+
+
+def screen_texts():
+    with urllib.request.urlopen(f"{SPECULOS_API}/events") as response:
+        return [event["text"] for event in json.load(response)["events"]]
+
+
+def use_target(transport, hmac):
+    try:
+        transport.apdu_exchange(CLA_APP, INS_CORE_USE_TARGET, TARGET + hmac)
+    except Exception as e:
+        return getattr(e, "sw", None)
+    return 0x9000
+
+
+if __name__ == '__main__':
+    transport = TransportClient()
+    client = AppClient(transport, chain=Chain.TEST)
+
+    fpr = client.get_master_fingerprint()
+    print(f"Fingerprint: {fpr.hex()}")
+
+    if fpr.hex() != "f5acc2fd":
+        print("This test assumes that the device is onboarded with the default mnemonic of Speculos")
+        client.stop()
+        exit(1)
+
+    wallet = WalletPolicy(
+        "",
+        "wpkh(@0/**)",
+        [
+            "[f5acc2fd/84'/1'/0']tpubDCtKfsNyRhULjZ9XMS4VKKtVcPdVDi8MKUbcSD9MJDyjRu1A2ND5MiipozyyspBT9bg8upEp7a8EAgFxNxXn1d7QkdbL52Ty5jiSLcxPt1P"
+        ],
+    )
+
+    # Approve the registration on the device
+    hmac = transport.apdu_exchange(CLA_APP, INS_CORE_REGISTER_TARGET, TARGET)
+    print("Target HMAC:", hmac.hex())
+    assert len(hmac) == 32
+
+    # A tampered HMAC is refused
+    tampered = bytes([hmac[0] ^ 1]) + hmac[1:]
+    sw = use_target(transport, tampered)
+    print(f"Tampered HMAC: {sw:#06x}" if sw is not None else "Tampered HMAC: no status word")
+    assert sw == SW_SIGNATURE_FAIL
+
+    # The registered target condenses the review of the next sign_psbt
+    assert use_target(transport, hmac) == 0x9000
+
+    psbt = PSBT()
+    psbt.deserialize(PSBT_STAKE)
+    clear_screen_events()
+    try:
+        sign_results = client.sign_psbt(psbt, wallet, None)
+    except Exception as e:
+        print("Error signing PSBT:", e)
+        client.stop()
+        exit(1)
+
+    print("Results of sign_psbt:", sign_results)
+    assert len(sign_results) == 1
+
+    texts = screen_texts()
+    assert "Registered" in texts, "the condensed review was not displayed"
+    assert "Delegator" not in texts
+
+    print("Staking target registration OK")
+    client.stop()